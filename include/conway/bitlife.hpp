@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Namespace holding this translation unit's copies of the inline kernel
+/// templates below. A kernel built with its own instruction-set flags
+/// defines it (avx2, avx512, ...) before any include, so its copies get
+/// their own symbols: otherwise the linker would keep one copy of, say,
+/// count_neighbours<uint64_t> for the whole program, and it could be the
+/// one compiled with -mavx2.
+#ifndef CONWAY_ISA_NAMESPACE
+#define CONWAY_ISA_NAMESPACE baseline
+#endif
+
+namespace conway {
+
+/// Any outer-totalistic rule compiled to its truth table over the count
+/// planes. The counts are split into the pairs {0,1}, {2,3}, {4,5}, {6,7}
+/// selected by (b2, b1); within a pair the next state is a function of
+/// (alive, b0) stored in algebraic normal form, so every entry is a
+/// broadcast mask and evaluation is a fixed, branch-free sequence of
+/// AND/XOR and three multiplexers whatever the rule. Count 8 is the only
+/// one with b3 set and gets its own (alive) function.
+///
+/// Only the table lives here, shared by every kernel; evaluate() runs it.
+struct TableEval {
+    /// pair[g] = {1, alive, b0, alive & b0} coefficients for counts 2g, 2g+1.
+    std::uint64_t pair[4][4];
+    /// eight = {1, alive} coefficients for count 8.
+    std::uint64_t eight[2];
+
+    constexpr TableEval(std::uint16_t birth, std::uint16_t survive) : pair{}, eight{}
+    {
+        auto mask = [](bool bit) { return bit ? ~std::uint64_t{0} : std::uint64_t{0}; };
+        auto next = [&](bool alive, unsigned count) {
+            return (((alive ? survive : birth) >> count) & 1u) != 0;
+        };
+        for (unsigned g = 0; g < 4; ++g) {
+            const bool t00 = next(false, 2 * g), t01 = next(false, 2 * g + 1);
+            const bool t10 = next(true, 2 * g), t11 = next(true, 2 * g + 1);
+            pair[g][0] = mask(t00);
+            pair[g][1] = mask(t00 ^ t10);
+            pair[g][2] = mask(t00 ^ t01);
+            pair[g][3] = mask(t00 ^ t01 ^ t10 ^ t11);
+        }
+        eight[0] = mask(next(false, 8));
+        eight[1] = mask(next(false, 8) ^ next(true, 8));
+    }
+};
+
+/// Any rule given as a 512-entry neighbourhood table (see Rule::table),
+/// compiled into a reduced ordered binary decision diagram over the nine
+/// cell planes. Every diagram node is one bit-sliced multiplexer, so an
+/// isotropic non-totalistic rule costs a fixed sequence of a few dozen to
+/// about 130 AND/XOR steps per word, with no per-cell lookups.
+///
+/// Values live in slots: 0 and 1 are all-zero and all-one, 2 + b is the
+/// plane of neighbourhood bit b, and each node writes a slot at or above
+/// kFirstNode that is reused once its value is dead. Nodes are stored
+/// children first, so evaluation is one forward pass.
+struct DecisionEval {
+    struct Node {
+        std::uint8_t var;
+        std::uint8_t dst;
+        std::uint8_t lo;
+        std::uint8_t hi;
+    };
+
+    static constexpr unsigned kFirstNode = 11;
+    /// Slot bound; nine variables never need more than this at once.
+    static constexpr unsigned kMaxSlots = 128;
+
+    std::vector<Node> nodes;
+    unsigned slot_count = kFirstNode;
+    unsigned result = 0;
+
+    explicit DecisionEval(const std::array<std::uint64_t, 8>& table);
+};
+
+inline namespace CONWAY_ISA_NAMESPACE {
+
+/// Bit-sliced neighbour count: for every lane, count = b0 + 2*b1 + 4*b2 + 8*b3.
+///
+/// V is any type with the bitwise operators: uint64_t for the scalar path, a
+/// GCC vector type for the SIMD paths. Keeping a single template guarantees
+/// every kernel computes bit-identical results.
+template <class V>
+struct NeighbourCount {
+    V b0, b1, b2, b3;
+};
+
+template <class V>
+inline void full_add(V a, V b, V c, V& sum, V& carry)
+{
+    const V t = a ^ b;
+    sum = t ^ c;
+    carry = (a & b) | (t & c);
+}
+
+template <class V>
+inline void half_add(V a, V b, V& sum, V& carry)
+{
+    sum = a ^ b;
+    carry = a & b;
+}
+
+/// Sums the eight neighbour planes with a small adder tree: one full adder
+/// per outer row, a half adder for the middle row, then a ripple of the
+/// weight-1, weight-2 and weight-4 columns (the total never exceeds 8).
+template <class V>
+inline NeighbourCount<V> count_neighbours(V nw, V n, V ne, V w, V e, V sw, V s, V se)
+{
+    V u0, u1, m0, m1, d0, d1;
+    full_add(nw, n, ne, u0, u1);
+    half_add(w, e, m0, m1);
+    full_add(sw, s, se, d0, d1);
+
+    NeighbourCount<V> c;
+    V c1, x2, x4, c2;
+    full_add(u0, m0, d0, c.b0, c1);
+    full_add(u1, m1, d1, x2, x4);
+    half_add(x2, c1, c.b1, c2);
+    half_add(x4, c2, c.b2, c.b3);
+    return c;
+}
+
+/// B3/S23: alive next generation iff count == 3, or count == 2 and alive.
+template <class V>
+inline V life_next(V alive, const NeighbourCount<V>& c)
+{
+    return c.b1 & ~c.b2 & ~c.b3 & (c.b0 | alive);
+}
+
+/// Cells shifted so that each lane sees its west (x - 1) neighbour; `prev`
+/// is the word holding the cells immediately to the west of `cur`.
+template <class V>
+inline V west_of(V prev, V cur)
+{
+    return (cur << 1) | (prev >> 63);
+}
+
+/// Cells shifted so that each lane sees its east (x + 1) neighbour.
+template <class V>
+inline V east_of(V cur, V next)
+{
+    return (cur >> 1) | (next << 63);
+}
+
+/// Neighbour count of every cell in the word `m`, given the 3x3 block of
+/// words around it.
+template <class V>
+inline NeighbourCount<V> count_word(V ul, V u, V ur, V ml, V m, V mr, V dl, V d, V dr)
+{
+    return count_neighbours(west_of(ul, u), u, east_of(u, ur),
+                            west_of(ml, m), east_of(m, mr),
+                            west_of(dl, d), d, east_of(d, dr));
+}
+
+/// Rule evaluators for the row kernels: evaluate() maps (alive, count)
+/// planes to the next-generation plane. B3/S23 needs no table.
+struct LifeEval {};
+
+/// A rule fixed at compile time. The truth table is a constant expression,
+/// so once inlined every mask folds away and the evaluator reduces to the
+/// few boolean operations that particular rule needs.
+template <std::uint16_t Birth, std::uint16_t Survive>
+struct FixedEval {};
+
+template <class V>
+inline V evaluate(const LifeEval&, V alive, const NeighbourCount<V>& c)
+{
+    return life_next(alive, c);
+}
+
+template <class V>
+inline V evaluate(const TableEval& t, V alive, const NeighbourCount<V>& c)
+{
+    const V ab = alive & c.b0;
+    V g[4];
+    for (unsigned i = 0; i < 4; ++i)
+        g[i] = (V{} | t.pair[i][0]) ^ (alive & t.pair[i][1]) ^ (c.b0 & t.pair[i][2]) ^ (ab & t.pair[i][3]);
+    const V lo = g[0] ^ ((g[0] ^ g[1]) & c.b1);
+    const V hi = g[2] ^ ((g[2] ^ g[3]) & c.b1);
+    const V r = lo ^ ((lo ^ hi) & c.b2);
+    const V e = (V{} | t.eight[0]) ^ (alive & t.eight[1]);
+    return r ^ ((r ^ e) & c.b3);
+}
+
+template <std::uint16_t Birth, std::uint16_t Survive, class V>
+inline V evaluate(const FixedEval<Birth, Survive>&, V alive, const NeighbourCount<V>& c)
+{
+    constexpr TableEval table(Birth, Survive);
+    return evaluate(table, alive, c);
+}
+
+/// Runs the decision diagram over the nine cell planes of a word.
+template <class V>
+inline V evaluate(const DecisionEval& d, const V (&cells)[9])
+{
+    V v[DecisionEval::kMaxSlots];
+    v[0] = V{};
+    v[1] = ~V{};
+    for (unsigned b = 0; b < 9; ++b)
+        v[2 + b] = cells[b];
+    const DecisionEval::Node* const nodes = d.nodes.data();
+    for (std::size_t k = 0; k < d.nodes.size(); ++k) {
+        const DecisionEval::Node& n = nodes[k];
+        const V lo = v[n.lo];
+        v[n.dst] = lo ^ ((lo ^ v[n.hi]) & v[n.var]);
+    }
+    return v[d.result];
+}
+
+/// Next state of one word given the 3x3 block of words around it.
+template <class V, class Eval>
+inline V next_word(const Eval& eval, V ul, V u, V ur, V ml, V m, V mr, V dl, V d, V dr)
+{
+    return evaluate(eval, m, count_word(ul, u, ur, ml, m, mr, dl, d, dr));
+}
+
+/// Decision-diagram rules read the nine cell planes instead of the count.
+template <class V>
+inline V next_word(const DecisionEval& eval, V ul, V u, V ur, V ml, V m, V mr, V dl, V d, V dr)
+{
+    const V cells[9] = {west_of(ul, u), u, east_of(u, ur),
+                        west_of(ml, m), m, east_of(m, mr),
+                        west_of(dl, d), d, east_of(d, dr)};
+    return evaluate(eval, cells);
+}
+
+} // namespace CONWAY_ISA_NAMESPACE
+
+} // namespace conway
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace conway {
+
+/// Output file behind a fixed-size buffer. Writers format straight into the
+/// buffer and it is flushed with write(2) whenever it fills, so producing a
+/// multi-gigabyte snapshot needs no memory beyond the buffer itself.
+class BufferedWriter {
+public:
+    static constexpr std::size_t kDefaultBuffer = std::size_t{1} << 16;
+
+    /// Creates or truncates `path`. Throws std::runtime_error on failure.
+    explicit BufferedWriter(const std::string& path, std::size_t buffer = kDefaultBuffer);
+    /// Flushes, but swallows errors; call close() to see them.
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    void put(char c)
+    {
+        if (used_ == buffer_.size())
+            flush();
+        buffer_[used_++] = c;
+    }
+
+    void write(std::string_view s)
+    {
+        if (s.size() > buffer_.size() - used_) {
+            flush();
+            if (s.size() > buffer_.size()) {
+                write_out(s.data(), s.size());
+                return;
+            }
+        }
+        s.copy(buffer_.data() + used_, s.size());
+        used_ += s.size();
+    }
+
+    void write_uint(std::uint64_t v)
+    {
+        char digits[20];
+        const auto r = std::to_chars(digits, digits + sizeof digits, v);
+        write(std::string_view(digits, static_cast<std::size_t>(r.ptr - digits)));
+    }
+
+    void flush();
+
+    /// Flushes and closes the file. Throws std::runtime_error on failure.
+    void close();
+
+    /// Bytes handed to the writer so far, flushed or not.
+    std::uint64_t bytes_written() const { return flushed_ + used_; }
+
+private:
+    void write_out(const char* data, std::size_t size);
+
+    int fd_ = -1;
+    std::string path_;
+    std::vector<char> buffer_;
+    std::size_t used_ = 0;
+    std::uint64_t flushed_ = 0;
+};
+
+} // namespace conway
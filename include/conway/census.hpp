@@ -0,0 +1,109 @@
+#pragma once
+
+#include "conway/packed_engine.hpp"
+#include "conway/rule.hpp"
+#include "conway/sparse_engine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace conway {
+
+/// Splits a settled board into separate objects and tallies them by an
+/// apgcode-like name.
+///
+/// The live cells are read as horizontal runs and joined by union-find:
+/// two runs belong to the same object when some of their cells are within
+/// two cells of each other, close enough for their neighbourhoods to share
+/// a cell. Each object is then run on its own until it recurs, which gives
+/// its period and whether it moved, and named as apgsearch does: `xs` plus
+/// the population for still lifes, `xp` or `xq` plus the period for
+/// oscillators and spaceships, then the extended Wechsler code of the
+/// orientation and phase with the shortest, then lexicographically least,
+/// code (`xs4_33` is the block, `xq4_153` the glider). Objects that do not
+/// recur within the period limit are named `zz_unsettled`, and objects too
+/// big to isolate `zz_large`.
+///
+/// Joining at distance two also joins neighbours that never interact, such
+/// as two blocks a cell apart. So a joined object whose 8-connected pieces
+/// evolve, each on its own, into exactly the joined object's phases for a
+/// whole period is counted as those pieces instead.
+///
+/// Names are cached by the object's exact shape, so common objects are
+/// classified once per Census. A Census is not thread-safe; give each
+/// worker its own and merge() them at the end.
+class Census {
+public:
+    explicit Census(const Rule& rule = Rule::life(), std::size_t max_period = 60);
+
+    /// Tallies the objects among the live cells of `engine`.
+    void add(const SparseEngine& engine);
+
+    /// Adds the tallies of `other`, e.g. another worker's census.
+    void merge(const Census& other);
+
+    /// Objects seen per name.
+    const std::unordered_map<std::string, std::uint64_t>& counts() const { return counts_; }
+    std::uint64_t objects() const { return objects_; }
+    /// Objects that had to be run, rather than found in the name cache.
+    std::uint64_t classified() const { return classified_; }
+
+private:
+    /// An object cropped to its bounding box; bit x of rows[y] is the cell
+    /// (x, y).
+    struct Shape {
+        int width = 0;
+        int height = 0;
+        std::vector<std::uint64_t> rows;
+
+        bool operator==(const Shape&) const = default;
+    };
+
+    /// A generation of an isolated object: its shape and where its
+    /// bounding box starts relative to where the object was placed.
+    struct Frame {
+        std::int64_t x0, y0;
+        Shape shape;
+    };
+
+    struct Run {
+        std::int64_t x0, x1, y;
+    };
+
+    struct Box {
+        std::int64_t x0, y0, x1, y1;
+    };
+
+    class RunSink;
+
+    /// Runs `shape` alone for up to `gens` generations, stopping early if
+    /// it dies, outgrows a word, or (with stop_on_repeat) recurs.
+    std::vector<Frame> evolve(const Shape& shape, std::size_t gens, bool stop_on_repeat);
+    /// Names of the objects making up `shape`.
+    std::vector<std::string> classify(const Shape& shape);
+    std::string name(const Shape& shape, const std::vector<Frame>& frames) const;
+    Shape crop(const Grid& grid, std::int64_t x0, std::int64_t y0, std::int64_t x1, std::int64_t y1) const;
+
+    std::size_t max_period_;
+    /// Board each object is isolated on, large enough for a spaceship to
+    /// travel max_period generations without wrapping into itself.
+    PackedEngine sandbox_;
+    std::unordered_map<std::string, std::vector<std::string>> names_;
+    std::unordered_map<std::string, std::uint64_t> counts_;
+    std::uint64_t objects_ = 0;
+    std::uint64_t classified_ = 0;
+
+    /// Scratch reused between add() calls.
+    std::vector<Run> runs_;
+    std::vector<std::uint32_t> parent_;
+    std::vector<std::size_t> row_start_;
+    /// Per run: index of its object. Per object: bounding box and shape.
+    std::vector<std::uint32_t> object_of_;
+    std::vector<Box> boxes_;
+    std::vector<Shape> shapes_;
+};
+
+} // namespace conway
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "conway/grid.hpp"
+#include "conway/packed_engine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace conway {
+
+/// Live-cell counts of a PackedEngine board in square blocks of 64 << k
+/// cells a side, from k = 0 (one block per engine tile) up to a level with a
+/// single block, kept up to date from the tiles each step changed.
+///
+/// Each level sums 2 x 2 blocks of the one below. After a step, update()
+/// reads the new count of every tile the step changed and adds the
+/// difference to the block holding it on each level, so it costs a pass
+/// over the change flags plus a few additions per changed tile, however
+/// much of the board is idle. Counts rather than occupancy bits are kept
+/// because a count can be decremented when cells die; a bit cannot.
+///
+/// downsample() draws a window of the board at 1 / zoom scale: one cell per
+/// zoom x zoom block, live if the block has any live cell. Blocks of 64
+/// cells or more are read from the pyramid and smaller ones from the board
+/// itself, so either way the cost follows the size of the window rather
+/// than the size of the board.
+class DensityPyramid {
+public:
+    /// Brings the counts up to date with `engine`. Called after every step,
+    /// it follows the step's changed tiles; otherwise (on first use, after
+    /// skipped steps, or for another engine) it recounts every tile. Edits
+    /// made through engine.current() are not seen by an incremental
+    /// update; call rebuild() after them.
+    void update(const PackedEngine& engine);
+    void rebuild(const PackedEngine& engine);
+
+    std::size_t levels() const { return levels_.size(); }
+    /// Blocks across and down `level`.
+    std::size_t width(std::size_t level) const { return levels_[level].width; }
+    std::size_t height(std::size_t level) const { return levels_[level].height; }
+    /// Live cells in block (bx, by) of `level`.
+    std::uint64_t count(std::size_t level, std::size_t bx, std::size_t by) const
+    {
+        const Level& l = levels_[level];
+        return l.counts[by * l.width + bx];
+    }
+
+    /// Blocks of `zoom` cells across a board of `cells` cells.
+    static std::size_t blocks(std::size_t cells, std::size_t zoom) { return (cells + zoom - 1) / zoom; }
+
+    /// Fills `out` with the board at 1 / zoom scale, cell (i, j) of `out`
+    /// standing for block (bx0 + i, by0 + j), wrapping around the board.
+    /// `zoom` is a power of two no larger than the top level's blocks.
+    void downsample(const PackedEngine& engine, std::size_t zoom, std::size_t bx0, std::size_t by0,
+                    Grid& out) const;
+
+private:
+    struct Level {
+        std::size_t width = 0;
+        std::size_t height = 0;
+        std::vector<std::uint64_t> counts;
+    };
+
+    void downsample_board(const Grid& board, std::size_t zoom, std::size_t bx0, std::size_t by0,
+                          Grid& out) const;
+
+    std::vector<Level> levels_;
+    const PackedEngine* engine_ = nullptr;
+    std::uint64_t generation_ = 0;
+};
+
+} // namespace conway
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "conway/buffered_writer.hpp"
+#include "conway/grid.hpp"
+#include "conway/kernel.hpp"
+#include "conway/pattern.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace conway {
+
+/// Toroidal stepper for Generations rules, with every state kept as packed
+/// bit planes.
+///
+/// The live cells (state 1) form one plane that is stepped by the ordinary
+/// row kernels, exactly as for a Life-like rule. Decaying cells carry a
+/// counter d = state - 1 in ceil(log2(states - 1)) further planes, updated
+/// in place with a bit-sliced ripple increment. A board therefore costs
+/// 1 + log2(states) bits per cell (plus the live plane's back buffer), and
+/// every update is word-wide logic rather than a byte-per-cell loop.
+class GenerationsEngine {
+public:
+    /// Accepts any rule, including two-state ones (which then never decay).
+    GenerationsEngine(std::size_t width, std::size_t height, const Rule& rule,
+                      std::string_view kernel = "auto");
+
+    const Rule& rule() const { return rule_; }
+    const RowKernel& kernel() const { return kernel_; }
+
+    std::size_t width() const { return alive_.width(); }
+    std::size_t height() const { return alive_.height(); }
+
+    /// The state-1 plane, for loading a pattern or a soup onto a board
+    /// with no decaying cells; use set_state() otherwise.
+    Grid& alive();
+    const Grid& alive() const { return alive_; }
+
+    unsigned state(std::size_t x, std::size_t y) const;
+    void set_state(std::size_t x, std::size_t y, unsigned state);
+
+    void step();
+    void run(std::uint64_t generations);
+
+    std::uint64_t generation() const { return generation_; }
+    /// Cells in state 1.
+    std::uint64_t population() const { return alive_.population(); }
+    /// Cells in states 2 and above.
+    std::uint64_t decaying() const;
+
+    /// Bit planes per cell: the live plane plus the decay counter.
+    std::size_t planes() const { return 1 + decay_.size(); }
+
+    /// Streams the bounding box of all non-dead cells as multistate RLE.
+    void write_rle(BufferedWriter& out) const;
+
+private:
+    void update_decay(std::size_t y, std::uint64_t* next_alive);
+
+    Rule rule_;
+    CompiledRule compiled_;
+    RowKernel kernel_;
+    Grid alive_;
+    Grid next_;
+    /// Decay counter planes, least significant first.
+    std::vector<Grid> decay_;
+    std::uint64_t generation_ = 0;
+    /// Per-row scratch for the decay update.
+    std::vector<std::uint64_t> carry_;
+    std::vector<std::uint64_t> last_;
+};
+
+/// CellSink that stamps multistate cells into a GenerationsEngine at an
+/// offset, wrapping around the torus.
+class GenerationsSink : public CellSink {
+public:
+    GenerationsSink(GenerationsEngine& engine, std::int64_t x0, std::int64_t y0)
+        : engine_(engine), alive_(engine.alive(), x0, y0), x0_(x0), y0_(y0)
+    {
+    }
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override;
+    void state_run(std::int64_t x, std::int64_t y, std::int64_t length, unsigned state) override;
+
+private:
+    GenerationsEngine& engine_;
+    GridSink alive_;
+    std::int64_t x0_;
+    std::int64_t y0_;
+};
+
+} // namespace conway
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace conway {
+
+/// Toroidal Life board stored as rows of 64-bit words, one bit per cell.
+///
+/// Bit j of word i in a row holds the cell at x = 64 * i + j. The width is
+/// rounded up to a whole number of words so that every row is a plain array
+/// of uint64_t and the kernels never have to mask a partial word.
+class Grid {
+public:
+    static constexpr std::size_t kWordBits = 64;
+
+    Grid() = default;
+    Grid(std::size_t width, std::size_t height);
+
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+    std::size_t words_per_row() const { return words_per_row_; }
+
+    std::uint64_t* row(std::size_t y) { return words_.data() + y * words_per_row_; }
+    const std::uint64_t* row(std::size_t y) const { return words_.data() + y * words_per_row_; }
+
+    std::uint64_t* data() { return words_.data(); }
+    const std::uint64_t* data() const { return words_.data(); }
+    std::size_t word_count() const { return words_.size(); }
+
+    bool get(std::size_t x, std::size_t y) const
+    {
+        return (row(y)[x / kWordBits] >> (x % kWordBits)) & 1u;
+    }
+
+    void set(std::size_t x, std::size_t y, bool alive)
+    {
+        std::uint64_t& word = row(y)[x / kWordBits];
+        const std::uint64_t bit = std::uint64_t{1} << (x % kWordBits);
+        word = alive ? (word | bit) : (word & ~bit);
+    }
+
+    void clear();
+
+    /// Number of live cells.
+    std::uint64_t population() const;
+
+    /// The 64 cells of row y starting at x, wrapping around the right edge.
+    std::uint64_t gather(std::size_t x, std::size_t y) const
+    {
+        const std::uint64_t* r = row(y);
+        const std::size_t w = x / kWordBits;
+        const unsigned s = static_cast<unsigned>(x % kWordBits);
+        std::uint64_t bits = r[w] >> s;
+        if (s)
+            bits |= r[w + 1 == words_per_row_ ? 0 : w + 1] << (kWordBits - s);
+        return bits;
+    }
+
+    /// Fills this grid with the same-sized window of `src` whose top-left
+    /// cell is (x0, y0), wrapping around src's edges.
+    void copy_window(const Grid& src, std::size_t x0, std::size_t y0);
+
+    /// Fills the board with independent random cells of the given density.
+    void randomize(double density, std::uint64_t seed);
+
+    friend void swap(Grid& a, Grid& b) noexcept
+    {
+        using std::swap;
+        swap(a.width_, b.width_);
+        swap(a.height_, b.height_);
+        swap(a.words_per_row_, b.words_per_row_);
+        swap(a.words_, b.words_);
+    }
+
+private:
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+    std::size_t words_per_row_ = 0;
+    std::vector<std::uint64_t> words_;
+};
+
+} // namespace conway
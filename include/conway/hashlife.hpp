@@ -0,0 +1,137 @@
+#pragma once
+
+#include "conway/pattern.hpp"
+#include "conway/rule.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace conway {
+
+/// Gosper's HashLife on an unbounded plane.
+///
+/// Every distinct square is stored once in a hash-consed node table keyed by
+/// its four quadrants, and each node memoises its centre advanced by
+/// 2^min(k, level - 2) generations for the current step exponent k. Nodes
+/// are 32-byte records addressed by 32-bit index; level-0 nodes 0 and 1 are
+/// the dead and live cell.
+///
+/// When the table grows past `memory_limit` bytes, unreachable nodes are
+/// reclaimed, between steps or in the middle of one: nodes held by the
+/// recursion in progress are pinned and survive. The limit is checked as
+/// nodes are added, so the table can pass it by what one recursion level
+/// allocates; and if more than the limit is live, the next collection
+/// waits until the table has doubled.
+class HashLife {
+public:
+    /// Throws std::runtime_error for B0 rules, which would fill the plane,
+    /// and for Generations rules.
+    explicit HashLife(const Rule& rule = Rule::life(),
+                      std::size_t memory_limit = std::size_t{1} << 30);
+
+    const Rule& rule() const { return rule_; }
+
+    void set_cell(std::int64_t x, std::int64_t y, bool alive = true);
+    bool get_cell(std::int64_t x, std::int64_t y) const;
+
+    /// Replaces the universe with a parsed macrocell tree, building nodes
+    /// directly rather than cell by cell. The root is centred on the origin.
+    void load_macrocell(const std::vector<MacrocellNode>& nodes);
+
+    /// Advances the universe by 2^k generations.
+    void step_pow2(unsigned k);
+
+    /// Advances by an arbitrary count, one power-of-two step per set bit.
+    void run(std::uint64_t generations);
+
+    std::uint64_t generation() const { return generation_; }
+    std::uint64_t population() const { return nodes_[root_].population; }
+
+    /// Bounding box of the live cells as half-open ranges; false if empty.
+    bool bounds(std::int64_t& x0, std::int64_t& y0, std::int64_t& x1, std::int64_t& y1) const;
+
+    /// Emits every live cell (as runs) to `sink`, in no particular order.
+    void for_each_live(CellSink& sink) const;
+
+    /// Streams the live cells as RLE, one row of the bounding box at a time.
+    void write_rle(BufferedWriter& out) const;
+
+    /// Streams the universe as a macrocell file: each distinct non-empty
+    /// node is written once, children before parents.
+    void write_macrocell(BufferedWriter& out) const;
+
+    void collect_garbage();
+
+    std::size_t node_count() const { return nodes_.size() - free_.size(); }
+    std::size_t memory_bytes() const;
+    std::size_t memory_limit() const { return memory_limit_; }
+    std::uint64_t gc_runs() const { return gc_runs_; }
+
+private:
+    static constexpr std::uint32_t kNone = 0xffffffffu;
+
+    struct Node {
+        std::uint32_t nw, ne, sw, se;
+        std::uint32_t result;
+        std::uint32_t level;
+        std::uint64_t population;
+    };
+
+    std::uint32_t join(std::uint32_t nw, std::uint32_t ne, std::uint32_t sw, std::uint32_t se);
+    std::uint32_t empty(std::uint32_t level);
+    std::uint32_t centre(std::uint32_t n);
+    std::uint32_t successor(std::uint32_t n, unsigned j);
+    std::uint32_t base_step(std::uint32_t n);
+    std::uint32_t leaf8(std::uint64_t bits);
+    std::uint32_t set_rec(std::uint32_t n, std::int64_t x, std::int64_t y, bool alive);
+    void expand();
+    bool centred() const;
+    void maybe_collect();
+    void set_step(unsigned k);
+    void rehash(std::size_t slots);
+    std::int64_t inset(std::uint32_t n, bool vertical, bool from_high,
+                       std::unordered_map<std::uint32_t, std::int64_t>& memo) const;
+    void row_runs(std::uint32_t n, std::int64_t x, std::int64_t y, std::int64_t row,
+                  std::int64_t x0, RleWriter& rle) const;
+    std::uint64_t leaf_bits(std::uint32_t n) const;
+    std::size_t root_half() const { return std::size_t{1} << (nodes_[root_].level - 1); }
+
+    Rule rule_;
+    std::size_t memory_limit_;
+    /// Table size that triggers the next collection.
+    std::size_t next_gc_bytes_;
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> free_;
+    std::vector<std::uint32_t> slots_;
+    std::size_t used_slots_ = 0;
+    std::vector<std::uint32_t> empty_;
+    /// Nodes held by successor() frames still running.
+    std::vector<std::uint32_t> pinned_;
+    /// 4x4 block (bit y*4+x) -> centre 2x2 one generation later (nw, ne, sw, se).
+    std::array<std::uint8_t, 65536> base_table_{};
+    std::uint32_t root_ = 0;
+    unsigned step_log2_ = 0;
+    std::uint64_t generation_ = 0;
+    std::uint64_t gc_runs_ = 0;
+};
+
+/// CellSink that loads runs into a HashLife universe at an offset.
+class HashLifeSink : public CellSink {
+public:
+    HashLifeSink(HashLife& life, std::int64_t x0, std::int64_t y0) : life_(life), x0_(x0), y0_(y0) {}
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override
+    {
+        for (std::int64_t i = 0; i < length; ++i)
+            life_.set_cell(x0_ + x + i, y0_ + y);
+    }
+
+private:
+    HashLife& life_;
+    std::int64_t x0_;
+    std::int64_t y0_;
+};
+
+} // namespace conway
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "conway/bitlife.hpp"
+#include "conway/rule.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace conway {
+
+/// A rule compiled once for the row kernels: the count-plane truth table
+/// used by outer-totalistic rules and the decision diagram used by
+/// isotropic non-totalistic ones.
+struct CompiledRule {
+    TableEval table;
+    DecisionEval decision;
+
+    explicit CompiledRule(const Rule& rule)
+        : table(rule.birth, rule.survive), decision(rule.neighbourhood_table()) {}
+};
+
+/// Computes words [begin, end) of one output row from the three input rows
+/// centred on it. Word indices wrap modulo `words`, so a full-width call
+/// implements the horizontal torus. The specialised kernels ignore `rule`.
+using RowKernelFn = void (*)(const std::uint64_t* up, const std::uint64_t* mid,
+                             const std::uint64_t* down, std::uint64_t* out,
+                             std::size_t words, std::size_t begin, std::size_t end,
+                             const CompiledRule& rule);
+
+struct RowKernel {
+    /// Instruction set: "avx512", "avx2" or "scalar".
+    const char* name;
+    /// Rule path: "life", "highlife" or "daynight" for the kernels
+    /// specialised at compile time on those rules, "table" for any other
+    /// outer-totalistic rule evaluated through its compiled truth table,
+    /// "decision" for non-totalistic rules run through their decision diagram.
+    const char* variant;
+    RowKernelFn fn;
+    /// Words processed per SIMD iteration (1 for the scalar kernel).
+    std::size_t lanes;
+};
+
+/// Instruction sets compiled into this binary and supported by the running
+/// CPU, widest first. "scalar" is always last.
+std::vector<std::string_view> available_isas();
+
+/// Resolves the kernel for an instruction set and rule. "auto" (or an empty
+/// name) consults the CONWAY_KERNEL environment variable and otherwise picks
+/// the widest ISA the CPU supports. Rules with a specialised kernel get it
+/// unless `specialise` is false. Throws std::runtime_error for unknown or
+/// unsupported names.
+RowKernel select_kernel(std::string_view name = "auto", const Rule& rule = Rule::life(),
+                        bool specialise = true);
+
+/// Every kernel on instruction set `isa` that implements `rule`: the
+/// specialised one if any, the table kernel for outer-totalistic rules and
+/// the decision kernel, which runs any rule. Used to cross-check them.
+std::vector<RowKernel> kernels_for(std::string_view isa, const Rule& rule);
+
+} // namespace conway
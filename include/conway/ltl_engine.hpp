@@ -0,0 +1,128 @@
+#pragma once
+
+#include "conway/buffered_writer.hpp"
+#include "conway/pattern.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace conway {
+
+/// Larger than Life rule in Golly's notation, e.g. Bosco's rule
+/// "R5,C0,M1,S34..58,B34..45,NM".
+///
+/// A cell counts the live cells within range R of it: the (2R+1)^2 box for
+/// the Moore neighbourhood (NM), or |dx| + |dy| <= R for von Neumann (NN).
+/// M1 includes the cell itself in the count. A dead cell is born when the
+/// count lies in [birth_min, birth_max], a live one survives when it lies in
+/// [survive_min, survive_max]; with C > 2 states a live cell that does not
+/// survive decays through states 2 to C - 1 as in Generations rules.
+struct LtlRule {
+    static constexpr unsigned kMaxRange = 10;
+
+    enum class Neighbourhood : std::uint8_t { moore, von_neumann };
+
+    unsigned range = 1;
+    std::uint16_t states = 2;
+    bool middle = false;
+    unsigned survive_min = 0;
+    unsigned survive_max = 0;
+    unsigned birth_min = 0;
+    unsigned birth_max = 0;
+    Neighbourhood neighbourhood = Neighbourhood::moore;
+
+    /// True for text in LtL form (starts with "R<digit>"), as opposed to
+    /// anything Rule::parse accepts.
+    static bool is_ltl(std::string_view text);
+
+    /// Accepts "R<r>,C<c>,M<0|1>,S<a>..<b>,B<a>..<b>,N<M|N>"; C, M and N
+    /// default to C0, M0 and NM. R must lie in 1..10. Throws
+    /// std::runtime_error on anything else.
+    static LtlRule parse(std::string_view text);
+
+    /// Canonical spelling with every field present.
+    std::string to_string() const;
+
+    /// Cells in the neighbourhood, including the middle one.
+    unsigned neighbourhood_size() const;
+
+    friend bool operator==(const LtlRule&, const LtlRule&) = default;
+};
+
+/// Toroidal stepper for Larger than Life rules.
+///
+/// Cells are stored one byte per cell. Neighbour counts never look at the
+/// whole (2R+1)^2 neighbourhood: Moore counts are a sliding box sum, a
+/// horizontal window from a row prefix sum followed by a running vertical
+/// sum over the last 2R+1 window rows; von Neumann counts move the diamond
+/// down one row at a time, adding the V of cells it gains and dropping the
+/// inverted V it loses, each arm read in O(1) from running prefix sums
+/// along the two diagonals. Only 2R+1 (Moore) or 2R+3 (von Neumann) rows of
+/// sums are kept, so a step costs a constant number of additions per cell
+/// whatever the range.
+class LtlEngine {
+public:
+    /// The width is rounded up to a multiple of 64, as for packed boards.
+    LtlEngine(std::size_t width, std::size_t height, const LtlRule& rule);
+
+    const LtlRule& rule() const { return rule_; }
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+
+    unsigned state(std::size_t x, std::size_t y) const { return cells_[y * width_ + x]; }
+    void set_state(std::size_t x, std::size_t y, unsigned state);
+
+    void step();
+    void run(std::uint64_t generations);
+
+    std::uint64_t generation() const { return generation_; }
+    /// Cells in state 1.
+    std::uint64_t population() const;
+    /// Cells in states 2 and above.
+    std::uint64_t decaying() const;
+
+    /// Streams the bounding box of all non-dead cells as RLE.
+    void write_rle(BufferedWriter& out) const;
+
+private:
+    void step_moore();
+    void step_von_neumann();
+    /// Next states of row `y` from its neighbour counts.
+    void update_row(std::size_t y, const std::uint16_t* counts);
+    /// Window sums of live cells in row `y` over x - R .. x + R.
+    void window_row(std::size_t y, std::uint16_t* out);
+    /// Live cells of row `y` with wrap-around padding of `pad` columns on
+    /// either side.
+    void padded_row(std::int64_t y, std::size_t pad, std::uint16_t* out) const;
+
+    LtlRule rule_;
+    std::size_t width_;
+    std::size_t height_;
+    std::vector<std::uint8_t> cells_;
+    std::vector<std::uint8_t> next_;
+    std::uint64_t generation_ = 0;
+    /// Ring of per-row sums (window rows for Moore; the two diagonal prefix
+    /// sums for von Neumann) and scratch rows, reused across steps.
+    std::vector<std::uint16_t> ring_;
+    std::vector<std::uint16_t> ring2_;
+    std::vector<std::uint16_t> counts_;
+    std::vector<std::uint16_t> scratch_;
+};
+
+/// CellSink that stamps cells into an LtlEngine at an offset, wrapping
+/// around the torus.
+class LtlSink : public CellSink {
+public:
+    LtlSink(LtlEngine& engine, std::int64_t x0, std::int64_t y0) : engine_(engine), x0_(x0), y0_(y0) {}
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override;
+    void state_run(std::int64_t x, std::int64_t y, std::int64_t length, unsigned state) override;
+
+private:
+    LtlEngine& engine_;
+    std::int64_t x0_;
+    std::int64_t y0_;
+};
+
+} // namespace conway
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "conway/grid.hpp"
+#include "conway/kernel.hpp"
+#include "conway/period.hpp"
+#include "conway/thread_pool.hpp"
+#include "conway/work_stealing.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace conway {
+
+/// Double-buffered stepper for any outer-totalistic rule over a toroidal
+/// packed Grid.
+///
+/// Each generation reads `current()` and writes the back buffer, 64 cells
+/// per word, then swaps the two. The row kernel is chosen once at
+/// construction (see select_kernel()).
+///
+/// The board is partitioned into tiles of one word by kTileRows rows. A tile
+/// is recomputed only if it or one of its eight neighbours changed in the
+/// previous generation; otherwise the back buffer already holds its
+/// (unchanged) contents and the tile costs nothing.
+///
+/// With more than one thread, tile rows are split into horizontal bands,
+/// one per worker of a persistent ThreadPool. Workers read only the front
+/// buffer and write only their own band of the back buffer and of the
+/// change flags, so the pool's end-of-step join is the only barrier.
+///
+/// Bands balance poorly when activity is concentrated in a few places, so
+/// Schedule::steal instead cuts the active tiles into short spans, deals
+/// them to per-worker work-stealing deques by band, and lets idle workers
+/// steal spans from busy ones.
+class PackedEngine {
+public:
+    static constexpr std::size_t kTileRows = 64;
+    /// Maximum adjacent tiles per work-stealing item.
+    static constexpr std::size_t kSpanTiles = 8;
+
+    enum class Schedule { bands, steal };
+
+    /// Cumulative per-worker figures since the last reset_worker_stats().
+    struct WorkerStats {
+        double busy_seconds = 0;
+        /// Time inside step() not spent computing tiles.
+        double idle_seconds = 0;
+        std::uint64_t tiles = 0;
+        std::uint64_t steals = 0;
+    };
+
+    PackedEngine(std::size_t width, std::size_t height, const Rule& rule = Rule::life(),
+                 std::string_view kernel = "auto");
+
+    /// Mutable access marks every tile as changed, since the caller may edit
+    /// any cell.
+    Grid& current()
+    {
+        invalidate();
+        return cur_;
+    }
+    const Grid& current() const { return cur_; }
+
+    const Rule& rule() const { return rule_; }
+    const RowKernel& kernel() const { return kernel_; }
+    /// Replaces the row kernel, e.g. to time the rule-table path of a rule
+    /// that has a specialised one. It must implement rule().
+    void set_kernel(const RowKernel& kernel) { kernel_ = kernel; }
+
+    std::uint64_t generation() const { return generation_; }
+    /// Sets the generation count, e.g. when resuming from a snapshot.
+    void set_generation(std::uint64_t generation) { generation_ = generation; }
+
+    /// Live cells. step() keeps the count from the popcounts of the words
+    /// it rewrites, so this is O(1) unless the board was edited through
+    /// current() since the last step.
+    std::uint64_t population() const;
+
+    /// Bounding box of the live cells as half-open ranges; false if empty.
+    /// step() keeps per-tile row and column occupancy masks and folds them
+    /// into the box, with the same O(1) caveat as population().
+    bool bounds(std::int64_t& x0, std::int64_t& y0, std::int64_t& x1, std::int64_t& y1) const;
+
+    /// Board hash: the sum of word_hash() over the non-empty words. step()
+    /// adds the difference for each word it changes, so like population()
+    /// it is O(1) between steps.
+    std::uint64_t hash() const;
+
+    void step();
+    void run(std::uint64_t generations);
+
+    /// Forces every tile to be recomputed on the next step.
+    void invalidate();
+
+    /// With skipping disabled every tile is recomputed every step.
+    void set_tile_skipping(bool enabled) { skip_tiles_ = enabled; }
+    bool tile_skipping() const { return skip_tiles_; }
+
+    std::size_t tiles_x() const { return tiles_x_; }
+    std::size_t tiles_y() const { return tiles_y_; }
+    std::size_t tile_count() const { return tiles_x_ * tiles_y_; }
+
+    /// Live cells in tile (tx, ty), kept by step() like population().
+    std::uint32_t tile_population(std::size_t tx, std::size_t ty) const;
+    /// Whether tile (tx, ty) changed in the most recent step.
+    bool tile_changed(std::size_t tx, std::size_t ty) const { return changed_[ty * tiles_x_ + tx] != 0; }
+
+    /// Tiles recomputed by the most recent step.
+    std::size_t active_tiles() const { return active_tiles_; }
+
+    /// Number of worker threads (including the caller) used by step().
+    void set_threads(std::size_t threads);
+    std::size_t threads() const { return stats_.size(); }
+
+    void set_schedule(Schedule schedule) { schedule_ = schedule; }
+    Schedule schedule() const { return schedule_; }
+
+    const std::vector<WorkerStats>& worker_stats() const { return stats_; }
+    void reset_worker_stats();
+
+private:
+    struct TileSpan {
+        std::uint32_t ty;
+        std::uint32_t tx0;
+        std::uint32_t tx1;
+    };
+
+    struct Box {
+        std::int64_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    };
+
+    /// What a span of tiles changed in the running population and hash.
+    struct Delta {
+        std::int64_t population = 0;
+        std::uint64_t hash = 0;
+
+        Delta& operator+=(const Delta& d)
+        {
+            population += d.population;
+            hash += d.hash;
+            return *this;
+        }
+    };
+
+    void mark_active();
+    Delta step_span(std::size_t ty, std::size_t tx0, std::size_t tx1, std::uint64_t* diff);
+    /// Occupancy masks of every tile, scanned from the board.
+    void summarise(std::vector<std::uint64_t>& rows, std::vector<std::uint64_t>& cols) const;
+    /// Hash of the whole board, scanned.
+    std::uint64_t scan_hash() const;
+    /// Recomputes the masks, population and hash after the board was edited
+    /// directly.
+    void rebuild_summary();
+    Box fold_box(const std::vector<std::uint64_t>& tile_rows,
+                 const std::vector<std::uint64_t>& tile_cols) const;
+    std::size_t step_tile_rows(std::size_t ty0, std::size_t ty1, std::vector<std::uint64_t>& diff,
+                               Delta& delta);
+    void run_bands();
+    void run_stealing();
+    void steal_worker(std::size_t index);
+
+    Rule rule_;
+    CompiledRule compiled_;
+    RowKernel kernel_;
+    Grid cur_;
+    Grid next_;
+    std::uint64_t generation_ = 0;
+
+    std::size_t tiles_x_;
+    std::size_t tiles_y_;
+    bool skip_tiles_ = true;
+    /// Per tile: contents differ between the last two generations.
+    std::vector<std::uint8_t> changed_;
+    /// Per tile: must be recomputed this step.
+    std::vector<std::uint8_t> active_;
+    std::size_t active_tiles_ = 0;
+
+    /// Per tile: bit r set if row r of the tile has a live cell, and the OR
+    /// of the tile's words (its occupied columns).
+    std::vector<std::uint64_t> tile_rows_;
+    std::vector<std::uint64_t> tile_cols_;
+    /// Per tile: live cells.
+    std::vector<std::uint32_t> tile_pop_;
+    std::uint64_t population_ = 0;
+    std::uint64_t hash_ = 0;
+    Box box_;
+    /// Set when current() may have been edited; the summary is rebuilt at
+    /// the next step and queries fall back to scanning the board.
+    bool summary_stale_ = true;
+
+    std::unique_ptr<ThreadPool> pool_;
+    /// Per worker: scratch change masks and statistics.
+    std::vector<std::vector<std::uint64_t>> diffs_;
+    std::vector<WorkerStats> stats_;
+    std::vector<std::size_t> band_active_;
+    std::vector<Delta> band_delta_;
+    std::vector<double> busy_before_;
+
+    Schedule schedule_ = Schedule::bands;
+    std::unique_ptr<WorkStealingDeque<TileSpan>[]> deques_;
+    std::atomic<std::size_t> spans_left_{0};
+};
+
+} // namespace conway
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "conway/buffered_writer.hpp"
+#include "conway/grid.hpp"
+#include "conway/rule.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace conway {
+
+/// Receives live cells from a pattern reader, one horizontal run at a time,
+/// so engines can load straight into their own representation.
+class CellSink {
+public:
+    virtual ~CellSink() = default;
+    virtual void live_run(std::int64_t x, std::int64_t y, std::int64_t length) = 0;
+    /// A run of multistate cells. Two-state sinks keep state 1 only.
+    virtual void state_run(std::int64_t x, std::int64_t y, std::int64_t length, unsigned state)
+    {
+        if (state == 1)
+            live_run(x, y, length);
+    }
+};
+
+struct PatternInfo {
+    std::int64_t width = 0;
+    std::int64_t height = 0;
+    /// Empty when the file does not name a rule.
+    std::string rule;
+    /// Generation recorded in the file (macrocell "#G"), else 0.
+    std::uint64_t generation = 0;
+};
+
+/// One node of a macrocell file. Level-3 nodes are 8x8 leaves stored in
+/// `leaf` (bit y * 8 + x); higher levels name their quadrants by index, with
+/// index 0 standing for an empty quadrant.
+struct MacrocellNode {
+    std::uint32_t level;
+    std::uint32_t nw, ne, sw, se;
+    std::uint64_t leaf;
+};
+
+/// Parses only the header of an RLE or macrocell file: the rule, and for
+/// RLE the declared size.
+PatternInfo read_pattern_info(std::string_view text);
+
+/// Parses RLE text, emitting live runs relative to the pattern's top-left
+/// corner. Throws std::runtime_error on malformed input.
+PatternInfo read_rle(std::string_view text, CellSink& sink);
+
+bool is_macrocell(std::string_view text);
+
+/// Parses a two-state macrocell file into its node list. nodes[0] is a
+/// placeholder for the empty node and the root is the last entry; the
+/// returned size is the root's side length. Throws std::runtime_error on
+/// malformed input.
+PatternInfo parse_macrocell(std::string_view text, std::vector<MacrocellNode>& nodes);
+
+/// Emits the live cells of a parsed macrocell tree relative to the root's
+/// top-left corner, skipping empty quadrants without visiting them.
+void emit_macrocell(const std::vector<MacrocellNode>& nodes, CellSink& sink);
+
+/// Streams RLE text from live runs fed in reading order.
+///
+/// Callers report live runs left to right within a row (x relative to the
+/// pattern's left edge) and advance with next_row(). The writer merges
+/// touching runs, drops trailing dead cells, collapses blank rows into one
+/// "n$" token and wraps lines at 70 columns, holding nothing but the
+/// pending token in memory. Generations rules (more than two states) are
+/// written with Golly's multistate alphabet.
+class RleWriter {
+public:
+    RleWriter(BufferedWriter& out, std::int64_t width, std::int64_t height, const Rule& rule);
+    /// For rules that Rule cannot express, spelled as `rule`.
+    RleWriter(BufferedWriter& out, std::int64_t width, std::int64_t height, std::string_view rule,
+              unsigned states);
+
+    void live(std::int64_t x, std::int64_t length);
+    /// A run of cells in `state` (1 = alive, 2.. = Generations decay).
+    void run(std::int64_t x, std::int64_t length, unsigned state);
+    void next_row(std::int64_t rows = 1);
+    void finish();
+
+private:
+    void emit(std::int64_t count, std::string_view tag);
+    void flush_run();
+
+    BufferedWriter& out_;
+    bool multistate_;
+    std::int64_t x_ = 0;
+    std::int64_t run_start_ = 0;
+    std::int64_t run_length_ = 0;
+    unsigned run_state_ = 1;
+    std::int64_t pending_rows_ = 0;
+    std::size_t column_ = 0;
+};
+
+/// Writes the bounding box of the live cells in `grid` as RLE, scanning
+/// packed words for runs with count-trailing-zeros.
+void write_rle(BufferedWriter& out, const Grid& grid, const Rule& rule);
+
+/// CellSink that stamps cells into a toroidal Grid at an offset.
+class GridSink : public CellSink {
+public:
+    GridSink(Grid& grid, std::int64_t x0, std::int64_t y0) : grid_(grid), x0_(x0), y0_(y0) {}
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override;
+
+private:
+    Grid& grid_;
+    std::int64_t x0_;
+    std::int64_t y0_;
+};
+
+} // namespace conway
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace conway {
+
+/// Hash contribution of one packed word at flat index `index` (row * words
+/// per row + column). Zero for an empty word, so a board's hash is the sum
+/// over its non-empty words and an engine can keep it current by adding
+/// word_hash(i, new) - word_hash(i, old) for just the words it rewrites.
+inline std::uint64_t word_hash(std::size_t index, std::uint64_t word)
+{
+    if (!word)
+        return 0;
+    // SplitMix64 finaliser over the word and its position.
+    std::uint64_t z = word ^ (static_cast<std::uint64_t>(index) * 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/// Ring of the board hashes of the last few generations, used to notice
+/// that a run has settled into still lifes and oscillators.
+///
+/// observe() is called once per generation and compares the new hash with
+/// each ring entry, newest first, so the first match is the smallest
+/// period. An entry must also match on population, which makes a false
+/// report need a 64-bit collision between boards of equal population.
+class PeriodDetector {
+public:
+    /// Looks for periods 1..max_period.
+    explicit PeriodDetector(std::size_t max_period);
+
+    std::size_t max_period() const { return ring_.size(); }
+
+    /// Records the next generation's board; returns its period, or 0 if it
+    /// matches none of the last max_period boards.
+    std::size_t observe(std::uint64_t hash, std::uint64_t population);
+
+    /// Forgets every recorded board, e.g. after the board was edited.
+    void reset() { count_ = 0; }
+
+private:
+    struct Entry {
+        std::uint64_t hash;
+        std::uint64_t population;
+    };
+
+    std::vector<Entry> ring_;
+    /// Next slot to write, and the number of valid entries.
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+};
+
+/// Decides from the population alone that a run on an unbounded plane has
+/// settled, as apgsearch does for soups.
+///
+/// A board of still lifes, oscillators and escaping spaceships has a
+/// periodic population even though the board itself never repeats. The
+/// detector keeps, for every candidate period p, how many consecutive
+/// generations have matched the population p generations earlier, which
+/// costs max_period comparisons per generation and no rescans.
+class PopulationPeriod {
+public:
+    /// Reports period p once `window` consecutive populations each equal
+    /// the one p generations before; `window` should cover a few periods.
+    PopulationPeriod(std::size_t max_period, std::size_t window);
+
+    /// Records the next generation's population; returns the smallest
+    /// settled period, or 0 while none is.
+    std::size_t observe(std::uint64_t population);
+
+    void reset();
+
+private:
+    std::size_t window_;
+    /// The last max_period + 1 populations, newest at head_ - 1.
+    std::vector<std::uint64_t> history_;
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+    /// Per period p (index p - 1): length of the current run of matches.
+    std::vector<std::size_t> runs_;
+};
+
+} // namespace conway
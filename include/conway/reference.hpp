@@ -0,0 +1,101 @@
+#pragma once
+
+#include "conway/ltl_engine.hpp"
+#include "conway/pattern.hpp"
+#include "conway/rule.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace conway {
+
+/// Deliberately naive stepper used as the oracle for every fast path.
+///
+/// One byte per cell on a torus; every cell reads its whole neighbourhood
+/// one cell at a time and asks the rule what happens (Rule::next_state on
+/// the 3x3 neighbourhood, or the LtL count compared against the intervals).
+/// Nothing is packed, cached, skipped or vectorised, so it is slow and easy
+/// to check by eye. Handles Life-like, non-totalistic, Generations and
+/// Larger than Life rules.
+class ReferenceEngine {
+public:
+    ReferenceEngine(std::size_t width, std::size_t height, const Rule& rule);
+    ReferenceEngine(std::size_t width, std::size_t height, const LtlRule& rule);
+
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+
+    unsigned state(std::size_t x, std::size_t y) const { return cells_[y * width_ + x]; }
+    void set_state(std::size_t x, std::size_t y, unsigned state);
+
+    void step();
+    void run(std::uint64_t generations);
+
+    std::uint64_t generation() const { return generation_; }
+    /// Cells in state 1.
+    std::uint64_t population() const;
+    /// board_hash() of the board.
+    std::uint64_t hash() const;
+
+    /// Bounding box of the state-1 cells as half-open ranges; false if none.
+    bool bounds(std::int64_t& x0, std::int64_t& y0, std::int64_t& x1, std::int64_t& y1) const;
+
+    /// True if a non-dead cell lies within `margin` cells of an edge, i.e.
+    /// the torus may already differ from an unbounded plane.
+    bool near_edge(std::size_t margin) const;
+
+private:
+    unsigned next_state(std::size_t x, std::size_t y) const;
+
+    std::size_t width_;
+    std::size_t height_;
+    Rule rule_;
+    std::optional<LtlRule> ltl_;
+    unsigned states_;
+    std::vector<std::uint8_t> cells_;
+    std::uint64_t generation_ = 0;
+};
+
+/// Order-independent hash of one non-dead cell; a board's hash is the sum
+/// over its cells, so any engine can compute it from a scan in whatever
+/// order it stores cells.
+std::uint64_t cell_hash(std::int64_t x, std::int64_t y, unsigned state = 1);
+
+/// CellSink that accumulates the hash and population of the runs it sees.
+class HashSink : public CellSink {
+public:
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override
+    {
+        for (std::int64_t i = 0; i < length; ++i)
+            hash_ += cell_hash(x + i, y);
+        population_ += static_cast<std::uint64_t>(length);
+    }
+
+    std::uint64_t hash() const { return hash_; }
+    std::uint64_t population() const { return population_; }
+
+private:
+    std::uint64_t hash_ = 0;
+    std::uint64_t population_ = 0;
+};
+
+/// CellSink that stamps cells into a ReferenceEngine at an offset, wrapping
+/// around the torus.
+class ReferenceSink : public CellSink {
+public:
+    ReferenceSink(ReferenceEngine& engine, std::int64_t x0, std::int64_t y0)
+        : engine_(engine), x0_(x0), y0_(y0) {}
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override
+    {
+        state_run(x, y, length, 1);
+    }
+    void state_run(std::int64_t x, std::int64_t y, std::int64_t length, unsigned state) override;
+
+private:
+    ReferenceEngine& engine_;
+    std::int64_t x0_;
+    std::int64_t y0_;
+};
+
+} // namespace conway
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace conway {
+
+/// Life-like rule: bit k of `birth` / `survive` is set when a dead / live
+/// cell with k live neighbours is alive next generation.
+///
+/// Isotropic non-totalistic rules (Hensel notation, e.g. "B2-a/S12") also
+/// fill `table`; for them `birth` / `survive` keep only the counts whose
+/// every neighbourhood is born / survives.
+///
+/// Generations rules (e.g. Brian's Brain "/2/3") have more than two
+/// `states`: a live cell that does not survive decays through states 2 to
+/// states - 1 and then dies, and only live (state 1) cells count as
+/// neighbours or can survive; decaying cells cannot be born.
+struct Rule {
+    std::uint16_t birth = 0;
+    std::uint16_t survive = 0;
+    /// Non-totalistic rules only: bit n is the next state of neighbourhood n,
+    /// in which bit 3 * (dy + 1) + (dx + 1) is the cell at offset (dx, dy)
+    /// (bit 4 is the cell itself). All zero for outer-totalistic rules.
+    std::array<std::uint64_t, 8> table{};
+    /// 2 for Life-like rules; up to 256 for Generations rules.
+    std::uint16_t states = 2;
+
+    static constexpr Rule life() { return {1u << 3, (1u << 2) | (1u << 3)}; }
+    /// B36/S23.
+    static constexpr Rule highlife() { return {(1u << 3) | (1u << 6), (1u << 2) | (1u << 3)}; }
+    /// B3678/S34678.
+    static constexpr Rule day_and_night()
+    {
+        return {(1u << 3) | (1u << 6) | (1u << 7) | (1u << 8),
+                (1u << 3) | (1u << 4) | (1u << 6) | (1u << 7) | (1u << 8)};
+    }
+
+    /// Accepts "B3/S23", "b3s23", the classic survive/birth form "23/3" and
+    /// Hensel notation such as "B2-a/S12" or "B3/S2-i34q". Rules whose
+    /// letters cover whole counts come back outer-totalistic. A third field
+    /// gives the Generations state count: "345/2/4", "B2/S345/C4" or
+    /// "B2/S/3". Throws std::runtime_error on anything else.
+    static Rule parse(std::string_view text);
+
+    /// Canonical "B.../S..." spelling, with Hensel letters where needed and
+    /// "/C<states>" for Generations rules.
+    std::string to_string() const;
+
+    constexpr bool is_life() const { return *this == life(); }
+
+    constexpr bool generations() const { return states > 2; }
+
+    constexpr bool totalistic() const
+    {
+        for (std::uint64_t w : table)
+            if (w)
+                return false;
+        return true;
+    }
+
+    /// Outer-totalistic rules only.
+    bool next(bool alive, unsigned count) const
+    {
+        return ((alive ? survive : birth) >> count) & 1u;
+    }
+
+    /// Next state of neighbourhood `n` (laid out as for `table`), for any rule.
+    bool next_state(std::uint32_t n) const
+    {
+        if (!totalistic())
+            return (table[n >> 6] >> (n & 63)) & 1u;
+        return next((n >> 4) & 1u, static_cast<unsigned>(std::popcount(n & ~0x10u)));
+    }
+
+    /// The 512-entry table of any rule, filled in for outer-totalistic ones.
+    std::array<std::uint64_t, 8> neighbourhood_table() const;
+
+    friend constexpr bool operator==(const Rule&, const Rule&) = default;
+};
+
+} // namespace conway
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "conway/buffered_writer.hpp"
+#include "conway/grid.hpp"
+#include "conway/mapped_file.hpp"
+#include "conway/rule.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace conway {
+
+/// Binary checkpoint of a packed board, read in place from a memory mapping.
+///
+/// Layout (little-endian, version 1):
+///
+///     header     magic "CWSNAP\r\n", version, board size, generation,
+///                population, tile size, rule text
+///     index      one entry per tile, row-major: payload offset, size and
+///                encoding
+///     payloads   tile rows, each starting on a 4096-byte page boundary;
+///                within a row each tile's payload is padded to 8 bytes
+///
+/// A tile is one word by 64 rows, the PackedEngine tile, so a snapshot
+/// written from an engine can be read back tile by tile into its board.
+/// A tile is stored `empty` (no payload), `raw` (its words from top to
+/// bottom) or, when compression is asked for and it pays, `sparse`: one
+/// byte per row flagging that row word's non-zero bytes, then those bytes
+/// in order. Settled Life ash is mostly zero bytes, so sparse tiles are a
+/// fraction of the raw size and decode with a few shifts per byte.
+///
+/// Nothing is read up front beyond the header and index: load() decodes
+/// each tile straight from the mapping into the engine's board, which the
+/// engine must own anyway to step it.
+class Snapshot {
+public:
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kTileRows = 64;
+    static constexpr std::size_t kPageSize = 4096;
+
+    enum class Encoding : std::uint8_t { empty, raw, sparse };
+
+    /// Reads the snapshot in `file`, which must outlive it. Checks the
+    /// header and that every payload lies inside the file; throws
+    /// std::runtime_error if not.
+    explicit Snapshot(const MappedFile& file);
+
+    /// True if `data` starts like a snapshot.
+    static bool is_snapshot(std::string_view data);
+
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+    std::uint64_t generation() const { return generation_; }
+    std::uint64_t population() const { return population_; }
+    /// Rule as written, e.g. "B3/S23".
+    const std::string& rule() const { return rule_; }
+
+    std::size_t tiles_x() const { return tiles_x_; }
+    std::size_t tiles_y() const { return tiles_y_; }
+
+    /// Decodes every tile into `grid`, which must have the snapshot's size.
+    void load(Grid& grid) const;
+
+private:
+    const char* data_;
+    std::size_t size_;
+    std::size_t width_;
+    std::size_t height_;
+    std::uint64_t generation_;
+    std::uint64_t population_;
+    std::string rule_;
+    std::size_t tiles_x_;
+    std::size_t tiles_y_;
+    const char* index_;
+};
+
+/// Writes `grid` with its rule and generation as a snapshot. With
+/// `compress`, tiles that are smaller that way are stored sparse.
+void write_snapshot(BufferedWriter& out, const Grid& grid, const Rule& rule, std::uint64_t generation,
+                    bool compress);
+
+} // namespace conway
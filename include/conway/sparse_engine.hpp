@@ -0,0 +1,125 @@
+#pragma once
+
+#include "conway/pattern.hpp"
+#include "conway/rule.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace conway {
+
+/// Unbounded Life universe made of 64x64 tiles kept in a hash map keyed by
+/// tile coordinate.
+///
+/// Tiles are allocated when live cells reach the edge facing an absent
+/// neighbour and released once they and all their neighbours are empty,
+/// so memory follows the live area rather than its bounding box. Every
+/// live tile keeps all eight neighbours allocated, and each tile links to
+/// them directly, so the step itself never touches the hash map.
+///
+/// Like the packed engine, a tile is recomputed only when it or one of its
+/// neighbours changed in the previous generation. A neighbour only counts
+/// if the change reached the edge or corner they share, so activity in the
+/// middle of a tile (a small soup, an oscillator) wakes just that tile.
+/// Each tile double-buffers its own rows, so a skipped tile costs nothing.
+class SparseEngine {
+public:
+    static constexpr std::int64_t kTileSize = 64;
+
+    /// Throws std::runtime_error for B0 rules, which would fill the plane.
+    explicit SparseEngine(const Rule& rule = Rule::life());
+
+    const Rule& rule() const { return rule_; }
+
+    void set_cell(std::int64_t x, std::int64_t y, bool alive = true);
+    bool get_cell(std::int64_t x, std::int64_t y) const;
+    /// Empties the universe and restarts at generation 0. Tile storage and
+    /// the index keep their capacity, so an engine reused for many small
+    /// patterns stops allocating after the first few.
+    void clear();
+
+    void step();
+    void run(std::uint64_t generations);
+
+    std::uint64_t generation() const { return generation_; }
+    std::uint64_t population() const { return population_; }
+
+    std::size_t tile_count() const { return index_.size(); }
+    std::size_t active_tiles() const { return active_tiles_; }
+    std::size_t memory_bytes() const;
+
+    /// Bounding box of the live cells as half-open ranges; false if empty.
+    bool bounds(std::int64_t& x0, std::int64_t& y0, std::int64_t& x1, std::int64_t& y1) const;
+
+    /// Emits every live cell to `sink` as horizontal runs, tile by tile.
+    void for_each_live(CellSink& sink) const;
+
+    /// Streams the live cells as RLE, one row of tiles at a time, so only
+    /// the sorted tile list is held in memory.
+    void write_rle(BufferedWriter& out) const;
+
+private:
+    static constexpr std::uint32_t kNone = 0xffffffffu;
+    /// Tile::changed bits: one per neighbour (nbr order) whose shared edge
+    /// or corner changed, plus one for the tile itself.
+    static constexpr std::uint16_t kChangedSelf = 0x100;
+    static constexpr std::uint16_t kChangedAll = 0x1ff;
+
+    struct Tile {
+        std::array<std::uint64_t, kTileSize> rows[2];
+        /// Neighbours in the order nw, n, ne, w, e, sw, s, se.
+        std::array<std::uint32_t, 8> nbr;
+        std::int32_t tx, ty;
+        std::uint32_t population;
+        std::uint16_t changed;
+        std::uint8_t cur;
+        std::uint8_t active;
+        std::uint8_t in_use;
+    };
+
+    static std::uint64_t key(std::int32_t tx, std::int32_t ty)
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(tx)) << 32
+            | static_cast<std::uint32_t>(ty);
+    }
+
+    std::uint32_t find(std::int32_t tx, std::int32_t ty) const;
+    std::uint32_t ensure(std::int32_t tx, std::int32_t ty);
+    void release(std::uint32_t id);
+    void ensure_neighbours(std::uint32_t id);
+    template <class Eval>
+    void compute(const Eval& eval, std::uint32_t id);
+
+    Rule rule_;
+    std::vector<Tile> tiles_;
+    std::vector<std::uint32_t> free_;
+    std::unordered_map<std::uint64_t, std::uint32_t> index_;
+    /// Tiles that changed in the previous step (or were edited since).
+    std::vector<std::uint32_t> changed_list_;
+    std::vector<std::uint32_t> active_list_;
+    std::uint64_t generation_ = 0;
+    std::uint64_t population_ = 0;
+    std::size_t active_tiles_ = 0;
+};
+
+/// CellSink that loads runs into a SparseEngine at an offset.
+class SparseSink : public CellSink {
+public:
+    SparseSink(SparseEngine& engine, std::int64_t x0, std::int64_t y0)
+        : engine_(engine), x0_(x0), y0_(y0) {}
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override
+    {
+        for (std::int64_t i = 0; i < length; ++i)
+            engine_.set_cell(x0_ + x + i, y0_ + y);
+    }
+
+private:
+    SparseEngine& engine_;
+    std::int64_t x0_;
+    std::int64_t y0_;
+};
+
+} // namespace conway
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "conway/grid.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace conway {
+
+/// Draws a window of a packed board on an ANSI terminal, sending only what
+/// changed since the previous frame.
+///
+/// A frame is one glyph code per character cell. The renderer keeps the
+/// codes it last sent, compares the new frame against them eight cells per
+/// 64-bit word, and for each row emits a cursor move and the glyphs of each
+/// changed span. Spans separated by a short unchanged gap are merged, since
+/// rewriting a few glyphs is cheaper than another cursor move. The whole
+/// frame, status line included, goes out in a single write(2), so the
+/// terminal never shows half a generation.
+///
+/// A character cell can show more than one board cell: as a pair of half
+/// blocks (1 x 2 cells) or a braille pattern (2 x 4 cells). The codes are then
+/// built straight from the packed rows, 64 cells at a time, by spreading
+/// bits into code bytes through a table, so the denser modes cost no more
+/// per character than one cell per character does.
+///
+/// The first frame, and the first after invalidate(), clears the screen and
+/// is drawn in full.
+class TerminalRenderer {
+public:
+    /// Board cells per character cell.
+    enum class Glyphs {
+        /// One cell: a space or a full block.
+        cell,
+        /// A column of two cells: upper, lower or full half blocks.
+        half,
+        /// Two columns of four cells: a braille pattern.
+        braille,
+    };
+
+    /// Draws on `fd` in a `columns` x `rows` area at the top left, plus one
+    /// status line below it.
+    TerminalRenderer(int fd, std::size_t columns, std::size_t rows, Glyphs glyphs = Glyphs::cell);
+    /// Moves the cursor below the drawing and shows it again.
+    ~TerminalRenderer();
+
+    TerminalRenderer(const TerminalRenderer&) = delete;
+    TerminalRenderer& operator=(const TerminalRenderer&) = delete;
+
+    std::size_t columns() const { return columns_; }
+    std::size_t rows() const { return rows_; }
+    /// Board cells shown across and down one character cell.
+    std::size_t cell_width() const { return cell_width_; }
+    std::size_t cell_height() const { return cell_height_; }
+
+    /// Draws the board window, columns() * cell_width() cells wide and
+    /// rows() * cell_height() high, whose top-left cell is (x0, y0), wrapping
+    /// around the torus, with `status` on the line below. Returns the bytes
+    /// written.
+    std::size_t render(const Grid& board, std::size_t x0, std::size_t y0, std::string_view status);
+
+    /// Makes the next frame a full redraw, e.g. after the terminal was
+    /// disturbed.
+    void invalidate() { drawn_ = false; }
+
+    std::uint64_t frames() const { return frames_; }
+    /// Bytes actually written, and what redrawing every frame in full would
+    /// have cost, over all frames so far.
+    std::uint64_t bytes() const { return bytes_; }
+    std::uint64_t full_bytes() const { return full_bytes_; }
+
+    /// Terminal size of `fd` in character cells, or 80 x 24 if unknown.
+    static void terminal_size(int fd, std::size_t& columns, std::size_t& rows);
+
+private:
+    void sample(const Grid& board, std::size_t x0, std::size_t y0);
+    void sample_braille(const Grid& board, std::size_t x0, std::size_t y0);
+    void emit_row(std::size_t y, bool full);
+    void move_to(std::size_t x, std::size_t y);
+    void send();
+
+    int fd_;
+    std::size_t columns_;
+    std::size_t rows_;
+    Glyphs mode_;
+    std::size_t cell_width_;
+    std::size_t cell_height_;
+    /// Glyph text per code.
+    std::vector<std::string> glyphs_;
+    /// Rows of codes, each padded to a whole number of 8-code words.
+    std::size_t stride_;
+    std::vector<std::uint8_t> frame_;
+    std::vector<std::uint8_t> shown_;
+    bool drawn_ = false;
+    std::string out_;
+    std::uint64_t frames_ = 0;
+    std::uint64_t bytes_ = 0;
+    std::uint64_t full_bytes_ = 0;
+};
+
+} // namespace conway
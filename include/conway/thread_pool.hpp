@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace conway {
+
+/// Fixed set of worker threads that live as long as the pool.
+///
+/// run() hands the same job to every worker and returns once all of them
+/// have finished, which makes it the only synchronisation point: engines call
+/// it once per generation and need no locking inside the job.
+class ThreadPool {
+public:
+    /// `threads` counts the calling thread, which acts as worker 0.
+    explicit ThreadPool(std::size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return workers_.size() + 1; }
+
+    /// Calls job(i) for every worker index i in [0, size()).
+    void run(const std::function<void(std::size_t)>& job);
+
+private:
+    void worker_loop(std::size_t index);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(std::size_t)>* job_ = nullptr;
+    std::uint64_t epoch_ = 0;
+    std::size_t pending_ = 0;
+    bool stop_ = false;
+};
+
+} // namespace conway
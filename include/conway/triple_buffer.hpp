@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace conway {
+
+/// Lock-free hand-off of the latest value from one writer thread to one
+/// reader thread.
+///
+/// Three slots rotate between the writer (back), the reader (front) and a
+/// middle slot holding the newest published value. publish() and acquire()
+/// each swap their slot with the middle one in a single atomic exchange, so
+/// neither side ever waits for the other: the writer can publish far more
+/// often than the reader looks, and the reader simply sees the newest
+/// value, skipping the rest.
+template <class T>
+class TripleBuffer {
+public:
+    /// Every slot starts as a copy of `initial`, so slots that need sizing
+    /// (grids, buffers) are sized once here and reused.
+    explicit TripleBuffer(const T& initial) : slots_{initial, initial, initial} {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /// Writer only: the slot to fill before the next publish().
+    T& back() { return slots_[back_]; }
+
+    /// Writer only: makes back() the newest value and takes a free slot
+    /// as the new back().
+    void publish()
+    {
+        const std::uint8_t old = middle_.exchange(static_cast<std::uint8_t>(back_ | kFresh),
+                                                  std::memory_order_acq_rel);
+        back_ = old & kIndex;
+    }
+
+    /// Reader only: moves the newest published value, if there is one not
+    /// yet seen, into front(). Returns whether it did.
+    bool acquire()
+    {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh))
+            return false;
+        const std::uint8_t old = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = old & kIndex;
+        return true;
+    }
+
+    /// Reader only.
+    const T& front() const { return slots_[front_]; }
+
+private:
+    static constexpr std::uint8_t kIndex = 3;
+    static constexpr std::uint8_t kFresh = 4;
+
+    T slots_[3];
+    /// Middle slot index, plus kFresh while it holds an unread value.
+    alignas(64) std::atomic<std::uint8_t> middle_{1};
+    alignas(64) std::uint8_t back_ = 0;
+    alignas(64) std::uint8_t front_ = 2;
+};
+
+} // namespace conway
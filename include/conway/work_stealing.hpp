@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace conway {
+
+/// Chase-Lev work-stealing deque with a fixed capacity.
+///
+/// The owner fills it with push() while no other thread looks at it (the
+/// engine does this before handing the generation to the pool), then pops
+/// from the bottom while thieves take from the top. Capacity never changes
+/// during a generation, so the usual buffer-growth dance is unnecessary.
+template <class T>
+class WorkStealingDeque {
+public:
+    /// Empties the deque and makes room for `capacity` items. Owner only,
+    /// with no concurrent thieves.
+    void reset(std::size_t capacity)
+    {
+        if (items_.size() < capacity)
+            items_.resize(capacity);
+        top_.store(0, std::memory_order_relaxed);
+        bottom_.store(0, std::memory_order_relaxed);
+    }
+
+    /// Owner only, with no concurrent thieves.
+    void push(const T& item)
+    {
+        const std::int64_t b = bottom_.load(std::memory_order_relaxed);
+        items_[static_cast<std::size_t>(b)] = item;
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /// Owner end. Returns false once the deque is empty.
+    bool pop(T& out)
+    {
+        const std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        out = items_[static_cast<std::size_t>(b)];
+        if (t != b)
+            return true;
+        // Last item: race any thief for it.
+        const bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                      std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    /// Thief end. May fail spuriously when racing another thread.
+    bool steal(T& out)
+    {
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+        out = items_[static_cast<std::size_t>(t)];
+        return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> items_;
+    std::atomic<std::int64_t> top_{0};
+    std::atomic<std::int64_t> bottom_{0};
+};
+
+} // namespace conway
@@ -0,0 +1,89 @@
+#include "conway/bitlife.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace conway {
+
+namespace {
+
+/// Variable order, top of the diagram first: the edge neighbours, then the
+/// corners, then the cell itself. Isotropic rules depend on the edges most
+/// and share the most subdiagrams this way.
+constexpr unsigned kOrder[9] = {1, 5, 7, 3, 0, 2, 8, 6, 4};
+
+} // namespace
+
+DecisionEval::DecisionEval(const std::array<std::uint64_t, 8>& table)
+{
+    // Truth table with kOrder[0] as the most significant index bit, so the
+    // two halves of any subtable are the cofactors of its top variable.
+    std::string root(512, '\0');
+    for (unsigned j = 0; j < 512; ++j) {
+        unsigned n = 0;
+        for (unsigned i = 0; i < 9; ++i)
+            if ((j >> (8 - i)) & 1u)
+                n |= 1u << kOrder[i];
+        root[j] = static_cast<char>((table[n >> 6] >> (n & 63)) & 1u);
+    }
+
+    // Each distinct subfunction becomes one node; the memo doubles as the
+    // unique table because equal functions have equal subtables. Nodes are
+    // numbered here and given slots below.
+    struct Built {
+        unsigned var, lo, hi;
+    };
+    std::vector<Built> built;
+    std::unordered_map<std::string, unsigned> memo;
+    auto build = [&](auto&& self, std::string_view tt, unsigned level) -> unsigned {
+        if (tt.find(tt[0] == 0 ? '\1' : '\0') == std::string_view::npos)
+            return tt[0] ? 1 : 0;
+        std::string key(tt); // its length identifies the level
+        if (const auto it = memo.find(key); it != memo.end())
+            return it->second;
+        const std::size_t half = tt.size() / 2;
+        const unsigned lo = self(self, tt.substr(0, half), level + 1);
+        const unsigned hi = self(self, tt.substr(half), level + 1);
+        unsigned id = lo;
+        if (lo != hi) {
+            built.push_back({2 + kOrder[level], lo, hi});
+            id = static_cast<unsigned>(kFirstNode + built.size() - 1);
+        }
+        memo.emplace(std::move(key), id);
+        return id;
+    };
+    const unsigned root_id = build(build, root, 0);
+
+    // Linear-scan slot allocation: a node's slot is freed after its last
+    // reader, which keeps the block evaluator's working set in L1.
+    std::vector<std::size_t> last_use(built.size(), 0);
+    for (std::size_t i = 0; i < built.size(); ++i)
+        for (unsigned in : {built[i].lo, built[i].hi})
+            if (in >= kFirstNode)
+                last_use[in - kFirstNode] = i;
+    std::vector<unsigned> slot_of(built.size());
+    std::vector<unsigned> free_slots;
+    auto slot = [&](unsigned id) { return id < kFirstNode ? id : slot_of[id - kFirstNode]; };
+    for (std::size_t i = 0; i < built.size(); ++i) {
+        const unsigned lo = slot(built[i].lo), hi = slot(built[i].hi);
+        for (unsigned in : {built[i].lo, built[i].hi})
+            if (in >= kFirstNode && last_use[in - kFirstNode] == i)
+                free_slots.push_back(slot(in)); // the node may overwrite its own input
+        unsigned dst;
+        if (!free_slots.empty()) {
+            dst = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            dst = slot_count++;
+            if (slot_count > kMaxSlots)
+                throw std::runtime_error("decision diagram needs too many slots");
+        }
+        slot_of[i] = dst;
+        nodes.push_back({static_cast<std::uint8_t>(built[i].var), static_cast<std::uint8_t>(dst),
+                         static_cast<std::uint8_t>(lo), static_cast<std::uint8_t>(hi)});
+    }
+    result = slot(root_id);
+}
+
+} // namespace conway
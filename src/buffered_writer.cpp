@@ -0,0 +1,64 @@
+#include "conway/buffered_writer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace conway {
+
+BufferedWriter::BufferedWriter(const std::string& path, std::size_t buffer)
+    : path_(path)
+    , buffer_(buffer == 0 ? 1 : buffer)
+{
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+        throw std::runtime_error("cannot write " + path + ": " + std::strerror(errno));
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    if (fd_ < 0)
+        return;
+    try {
+        flush();
+    } catch (...) {
+    }
+    ::close(fd_);
+}
+
+void BufferedWriter::write_out(const char* data, std::size_t size)
+{
+    while (size > 0) {
+        const ssize_t n = ::write(fd_, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("write to " + path_ + " failed: " + std::strerror(errno));
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        flushed_ += static_cast<std::uint64_t>(n);
+    }
+}
+
+void BufferedWriter::flush()
+{
+    const std::size_t n = used_;
+    used_ = 0;
+    write_out(buffer_.data(), n);
+}
+
+void BufferedWriter::close()
+{
+    if (fd_ < 0)
+        return;
+    flush();
+    const int fd = fd_;
+    fd_ = -1;
+    if (::close(fd) != 0)
+        throw std::runtime_error("closing " + path_ + " failed: " + std::strerror(errno));
+}
+
+} // namespace conway
@@ -0,0 +1,387 @@
+#include "conway/census.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <numeric>
+
+namespace conway {
+
+namespace {
+
+/// Objects whose bounding box is larger than this either way are not
+/// isolated.
+constexpr std::int64_t kMaxObject = 48;
+
+std::size_t sandbox_side(std::size_t max_period)
+{
+    // The object plus max_period cells of travel at speed c either side.
+    return static_cast<std::size_t>(kMaxObject) + 2 * max_period + 16;
+}
+
+std::uint32_t find_root(std::vector<std::uint32_t>& parent, std::uint32_t i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void unite(std::vector<std::uint32_t>& parent, std::uint32_t a, std::uint32_t b)
+{
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a != b)
+        parent[std::max(a, b)] = std::min(a, b);
+}
+
+constexpr char kDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+/// Extended Wechsler format: strips of five rows separated by 'z', one
+/// base-32 digit per column, 'w', 'x' and 'y'+digit for runs of 2, 3 and
+/// 4..39 blank columns, trailing blank columns dropped.
+template <class Cell>
+std::string wechsler(int width, int height, const Cell& cell)
+{
+    std::string out;
+    for (int strip = 0; strip * 5 < height; ++strip) {
+        if (strip)
+            out += 'z';
+        int blank = 0;
+        for (int x = 0; x < width; ++x) {
+            int v = 0;
+            for (int k = 0; k < 5 && strip * 5 + k < height; ++k)
+                v |= cell(x, strip * 5 + k) << k;
+            if (!v) {
+                ++blank;
+                continue;
+            }
+            for (; blank >= 40; blank -= 39)
+                out += "yz";
+            if (blank == 1)
+                out += '0';
+            else if (blank == 2)
+                out += 'w';
+            else if (blank == 3)
+                out += 'x';
+            else if (blank >= 4)
+                out += {'y', kDigits[blank - 4]};
+            blank = 0;
+            out += kDigits[v];
+        }
+    }
+    return out;
+}
+
+/// apgcode order: shorter first, then lexicographic.
+bool better(const std::string& a, const std::string& b)
+{
+    return a.size() != b.size() ? a.size() < b.size() : a < b;
+}
+
+} // namespace
+
+/// Collects the live runs of an engine.
+class Census::RunSink : public CellSink {
+public:
+    explicit RunSink(std::vector<Run>& runs) : runs_(runs) {}
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override
+    {
+        runs_.push_back({x, x + length, y});
+    }
+
+private:
+    std::vector<Run>& runs_;
+};
+
+Census::Census(const Rule& rule, std::size_t max_period)
+    : max_period_(max_period)
+    , sandbox_(sandbox_side(max_period), sandbox_side(max_period), rule)
+{
+}
+
+Census::Shape Census::crop(const Grid& grid, std::int64_t x0, std::int64_t y0, std::int64_t x1,
+                           std::int64_t y1) const
+{
+    Shape s;
+    s.width = static_cast<int>(x1 - x0);
+    s.height = static_cast<int>(y1 - y0);
+    s.rows.resize(static_cast<std::size_t>(s.height));
+    const std::size_t word = static_cast<std::size_t>(x0) / 64;
+    const unsigned shift = static_cast<unsigned>(x0 % 64);
+    const std::uint64_t mask = s.width == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << s.width) - 1;
+    for (int y = 0; y < s.height; ++y) {
+        const std::uint64_t* row = grid.row(static_cast<std::size_t>(y0 + y));
+        std::uint64_t bits = row[word] >> shift;
+        if (shift && word + 1 < grid.words_per_row())
+            bits |= row[word + 1] << (64 - shift);
+        s.rows[static_cast<std::size_t>(y)] = bits & mask;
+    }
+    return s;
+}
+
+std::vector<Census::Frame> Census::evolve(const Shape& shape, std::size_t gens, bool stop_on_repeat)
+{
+    const auto origin = static_cast<std::int64_t>(sandbox_.current().width() - kMaxObject) / 2;
+    Grid& board = sandbox_.current();
+    board.clear();
+    for (int y = 0; y < shape.height; ++y)
+        for (std::uint64_t w = shape.rows[static_cast<std::size_t>(y)]; w; w &= w - 1)
+            board.set(static_cast<std::size_t>(origin + std::countr_zero(w)),
+                      static_cast<std::size_t>(origin + y), true);
+
+    std::vector<Frame> frames;
+    for (std::size_t g = 1; g <= gens; ++g) {
+        sandbox_.step();
+        std::int64_t x0, y0, x1, y1;
+        if (!sandbox_.bounds(x0, y0, x1, y1) || x1 - x0 > 64)
+            break;
+        frames.push_back({x0 - origin, y0 - origin, crop(sandbox_.current(), x0, y0, x1, y1)});
+        if (stop_on_repeat && frames.back().shape == shape)
+            break;
+    }
+    return frames;
+}
+
+std::string Census::name(const Shape& shape, const std::vector<Frame>& frames) const
+{
+    if (frames.empty() || !(frames.back().shape == shape))
+        return "zz_unsettled";
+    const std::size_t period = frames.size();
+    const bool moved = frames.back().x0 || frames.back().y0;
+
+    std::string best;
+    auto consider = [&best](const Shape& p) {
+        auto cell = [&p](int x, int y) { return static_cast<int>(p.rows[static_cast<std::size_t>(y)] >> x & 1); };
+        // The eight orientations: optional transpose, then optional flips.
+        for (int t = 0; t < 8; ++t) {
+            const bool swap = t & 4, flip_x = t & 1, flip_y = t & 2;
+            const int w = swap ? p.height : p.width;
+            const int h = swap ? p.width : p.height;
+            std::string code = wechsler(w, h, [&](int x, int y) {
+                x = flip_x ? w - 1 - x : x;
+                y = flip_y ? h - 1 - y : y;
+                return swap ? cell(y, x) : cell(x, y);
+            });
+            if (best.empty() || better(code, best))
+                best = std::move(code);
+        }
+    };
+    for (const Frame& f : frames)
+        consider(f.shape);
+
+    std::string prefix;
+    if (period == 1 && !moved) {
+        std::uint64_t population = 0;
+        for (std::uint64_t r : shape.rows)
+            population += static_cast<std::uint64_t>(std::popcount(r));
+        prefix = "xs" + std::to_string(population);
+    } else {
+        prefix = (moved ? "xq" : "xp") + std::to_string(period);
+    }
+    return prefix + "_" + best;
+}
+
+std::vector<std::string> Census::classify(const Shape& shape)
+{
+    const std::vector<Frame> frames = evolve(shape, max_period_, true);
+
+    // Split into 8-connected pieces by flood fill, each with its offset.
+    std::vector<Frame> pieces;
+    Shape left = shape;
+    for (int y = 0; y < shape.height; ++y) {
+        while (left.rows[static_cast<std::size_t>(y)]) {
+            Shape piece{shape.width, shape.height, std::vector<std::uint64_t>(shape.rows.size())};
+            piece.rows[static_cast<std::size_t>(y)] = left.rows[static_cast<std::size_t>(y)]
+                & -left.rows[static_cast<std::size_t>(y)];
+            for (bool grew = true; grew;) {
+                grew = false;
+                for (int r = 0; r < shape.height; ++r) {
+                    std::uint64_t reach = 0;
+                    for (int d = -1; d <= 1; ++d)
+                        if (r + d >= 0 && r + d < shape.height) {
+                            const std::uint64_t w = piece.rows[static_cast<std::size_t>(r + d)];
+                            reach |= w | w << 1 | w >> 1;
+                        }
+                    const std::uint64_t add = reach & left.rows[static_cast<std::size_t>(r)]
+                        & ~piece.rows[static_cast<std::size_t>(r)];
+                    if (add) {
+                        piece.rows[static_cast<std::size_t>(r)] |= add;
+                        grew = true;
+                    }
+                }
+            }
+            for (int r = 0; r < shape.height; ++r)
+                left.rows[static_cast<std::size_t>(r)] &= ~piece.rows[static_cast<std::size_t>(r)];
+            // Crop the piece to its own bounding box.
+            int top = shape.height, bottom = 0;
+            std::uint64_t cols = 0;
+            for (int r = 0; r < shape.height; ++r)
+                if (piece.rows[static_cast<std::size_t>(r)]) {
+                    top = std::min(top, r);
+                    bottom = r + 1;
+                    cols |= piece.rows[static_cast<std::size_t>(r)];
+                }
+            const int x0 = std::countr_zero(cols);
+            Shape cropped{64 - std::countl_zero(cols) - x0, bottom - top, {}};
+            for (int r = top; r < bottom; ++r)
+                cropped.rows.push_back(piece.rows[static_cast<std::size_t>(r)] >> x0);
+            pieces.push_back({x0, top, std::move(cropped)});
+        }
+    }
+
+    // Separable if, for the joined object's whole period, the pieces run
+    // apart add up to exactly the joined object.
+    bool separable = pieces.size() > 1 && !frames.empty() && frames.back().shape == shape;
+    std::vector<std::vector<Frame>> apart;
+    for (std::size_t i = 0; separable && i < pieces.size(); ++i) {
+        apart.push_back(evolve(pieces[i].shape, frames.size(), false));
+        separable = apart.back().size() == frames.size();
+    }
+    std::vector<std::uint64_t> joined, sum;
+    auto add_cells = [](std::vector<std::uint64_t>& cells, const Frame& f, std::int64_t dx, std::int64_t dy) {
+        for (int y = 0; y < f.shape.height; ++y)
+            for (std::uint64_t w = f.shape.rows[static_cast<std::size_t>(y)]; w; w &= w - 1)
+                cells.push_back(static_cast<std::uint64_t>(f.y0 + dy + y + 1024) << 32
+                                | static_cast<std::uint64_t>(f.x0 + dx + std::countr_zero(w) + 1024));
+    };
+    for (std::size_t g = 0; separable && g < frames.size(); ++g) {
+        joined.clear();
+        sum.clear();
+        add_cells(joined, frames[g], 0, 0);
+        for (std::size_t i = 0; i < pieces.size(); ++i)
+            add_cells(sum, apart[i][g], pieces[i].x0, pieces[i].y0);
+        std::sort(joined.begin(), joined.end());
+        std::sort(sum.begin(), sum.end());
+        separable = joined == sum;
+    }
+
+    if (!separable)
+        return {name(shape, frames)};
+    std::vector<std::string> names;
+    for (const Frame& piece : pieces)
+        names.push_back(name(piece.shape, evolve(piece.shape, max_period_, true)));
+    return names;
+}
+
+void Census::add(const SparseEngine& engine)
+{
+    std::vector<Run>& runs = runs_;
+    runs.clear();
+    RunSink sink(runs);
+    engine.for_each_live(sink);
+    if (runs.empty())
+        return;
+    std::sort(runs.begin(), runs.end(),
+              [](const Run& a, const Run& b) { return a.y != b.y ? a.y < b.y : a.x0 < b.x0; });
+
+    // Runs arrive tile by tile, so first rejoin runs that a tile edge split.
+    std::size_t n = 0;
+    for (const Run& r : runs) {
+        if (n && runs[n - 1].y == r.y && runs[n - 1].x1 == r.x0)
+            runs[n - 1].x1 = r.x1;
+        else
+            runs[n++] = r;
+    }
+    runs.resize(n);
+
+    row_start_.clear();
+    for (std::size_t i = 0; i < n; ++i)
+        if (i == 0 || runs[i].y != runs[i - 1].y)
+            row_start_.push_back(i);
+    row_start_.push_back(n);
+
+    // Runs are joined when a cell of one is within two cells of a cell of
+    // the other, in the same row or up to two rows below: a sweep over each
+    // such pair of rows with one pointer per row.
+    parent_.resize(n);
+    std::iota(parent_.begin(), parent_.end(), 0u);
+    const std::size_t rows = row_start_.size() - 1;
+    for (std::size_t a = 0; a < rows; ++a) {
+        for (std::size_t b = a; b < rows && runs[row_start_[b]].y - runs[row_start_[a]].y <= 2; ++b) {
+            std::size_t j = row_start_[b];
+            for (std::size_t i = row_start_[a]; i < row_start_[a + 1]; ++i) {
+                while (j < row_start_[b + 1] && runs[j].x1 + 1 < runs[i].x0)
+                    ++j;
+                for (std::size_t k = j; k < row_start_[b + 1] && runs[k].x0 <= runs[i].x1 + 1; ++k)
+                    if (k != i)
+                        unite(parent_, static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(k));
+            }
+        }
+    }
+
+    // Number the objects; a root is always its object's first run, so
+    // every run sees its root's number already assigned.
+    constexpr std::uint32_t kNoObject = 0xffffffffu;
+    object_of_.assign(n, kNoObject);
+    boxes_.clear();
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint32_t root = find_root(parent_, static_cast<std::uint32_t>(i));
+        const Run& r = runs[i];
+        if (root == i) {
+            object_of_[i] = static_cast<std::uint32_t>(boxes_.size());
+            boxes_.push_back({r.x0, r.y, r.x1, r.y + 1});
+            continue;
+        }
+        object_of_[i] = object_of_[root];
+        Box& b = boxes_[object_of_[i]];
+        b.x0 = std::min(b.x0, r.x0);
+        b.x1 = std::max(b.x1, r.x1);
+        b.y1 = r.y + 1;
+    }
+
+    const std::size_t objects = boxes_.size();
+    if (shapes_.size() < objects)
+        shapes_.resize(objects);
+    for (std::size_t o = 0; o < objects; ++o) {
+        const Box& b = boxes_[o];
+        Shape& s = shapes_[o];
+        const bool fits = b.x1 - b.x0 <= kMaxObject && b.y1 - b.y0 <= kMaxObject;
+        s.width = fits ? static_cast<int>(b.x1 - b.x0) : 0;
+        s.height = fits ? static_cast<int>(b.y1 - b.y0) : 0;
+        s.rows.assign(static_cast<std::size_t>(s.height), 0);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        const Box& b = boxes_[object_of_[i]];
+        Shape& s = shapes_[object_of_[i]];
+        const Run& r = runs[i];
+        if (!s.height)
+            continue;
+        const std::int64_t len = r.x1 - r.x0;
+        const std::uint64_t bits = len == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << len) - 1;
+        s.rows[static_cast<std::size_t>(r.y - b.y0)] |= bits << (r.x0 - b.x0);
+    }
+
+    std::string key;
+    for (std::size_t o = 0; o < objects; ++o) {
+        const Shape& s = shapes_[o];
+        if (!s.height) {
+            ++objects_;
+            ++counts_["zz_large"];
+            continue;
+        }
+        key.assign(2 + s.rows.size() * sizeof(std::uint64_t), '\0');
+        key[0] = static_cast<char>(s.width);
+        key[1] = static_cast<char>(s.height);
+        std::memcpy(key.data() + 2, s.rows.data(), s.rows.size() * sizeof(std::uint64_t));
+        auto [names, fresh] = names_.try_emplace(key);
+        if (fresh) {
+            names->second = classify(s);
+            ++classified_;
+        }
+        objects_ += names->second.size();
+        for (const std::string& name : names->second)
+            ++counts_[name];
+    }
+}
+
+void Census::merge(const Census& other)
+{
+    for (const auto& [name, count] : other.counts_)
+        counts_[name] += count;
+    objects_ += other.objects_;
+    classified_ += other.classified_;
+}
+
+} // namespace conway
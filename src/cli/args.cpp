@@ -0,0 +1,111 @@
+#include "cli/args.hpp"
+
+#include <stdexcept>
+
+namespace conway::cli {
+
+Args::Args(int argc, char** argv, int first)
+{
+    for (int i = first; i < argc; ++i)
+        tokens_.push_back({argv[i]});
+}
+
+Args::Token* Args::find(std::string_view name, std::string* inline_value)
+{
+    for (Token& t : tokens_) {
+        std::string_view text = t.text;
+        if (t.used || text.substr(0, 2) != "--")
+            continue;
+        text.remove_prefix(2);
+        if (text == name)
+            return &t;
+        if (inline_value && text.size() > name.size() && text.substr(0, name.size()) == name
+            && text[name.size()] == '=') {
+            *inline_value = std::string(text.substr(name.size() + 1));
+            return &t;
+        }
+    }
+    return nullptr;
+}
+
+bool Args::flag(std::string_view name)
+{
+    Token* t = find(name, nullptr);
+    if (!t)
+        return false;
+    t->used = true;
+    return true;
+}
+
+std::string Args::get(std::string_view name, const std::string& fallback)
+{
+    std::string value;
+    Token* t = find(name, &value);
+    if (!t)
+        return fallback;
+    t->used = true;
+    if (t->text.size() > name.size() + 2)
+        return value;
+    Token* next = t + 1;
+    if (next == tokens_.data() + tokens_.size() || next->used)
+        throw std::runtime_error("option --" + std::string(name) + " needs a value");
+    next->used = true;
+    return next->text;
+}
+
+std::uint64_t Args::get_u64(std::string_view name, std::uint64_t fallback)
+{
+    const std::string text = get(name, "");
+    if (text.empty())
+        return fallback;
+    // "2^30" is accepted as shorthand for huge generation counts.
+    const std::size_t caret = text.find('^');
+    std::size_t end = 0;
+    const unsigned long long v = std::stoull(text.substr(0, caret), &end, 0);
+    if (caret == std::string::npos) {
+        if (end != text.size())
+            throw std::runtime_error("option --" + std::string(name) + ": not an integer: " + text);
+        return v;
+    }
+    std::size_t exp_end = 0;
+    const unsigned long long e = std::stoull(text.substr(caret + 1), &exp_end, 10);
+    if (end != caret || exp_end != text.size() - caret - 1)
+        throw std::runtime_error("option --" + std::string(name) + ": not an integer: " + text);
+    unsigned long long result = 1;
+    for (unsigned long long i = 0; i < e; ++i)
+        result *= v;
+    return result;
+}
+
+double Args::get_double(std::string_view name, double fallback)
+{
+    const std::string text = get(name, "");
+    if (text.empty())
+        return fallback;
+    std::size_t end = 0;
+    const double v = std::stod(text, &end);
+    if (end != text.size())
+        throw std::runtime_error("option --" + std::string(name) + ": not a number: " + text);
+    return v;
+}
+
+std::vector<std::string> Args::positional()
+{
+    std::vector<std::string> out;
+    for (Token& t : tokens_) {
+        if (t.used || t.text.substr(0, 2) == "--")
+            continue;
+        t.used = true;
+        out.push_back(t.text);
+    }
+    return out;
+}
+
+void Args::finish() const
+{
+    for (const Token& t : tokens_)
+        if (!t.used)
+            throw std::runtime_error("unrecognised argument: " + t.text);
+}
+
+} // namespace conway::cli
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace conway::cli {
+
+/// Minimal `--key value` / `--key=value` / `--flag` parser.
+///
+/// Options are looked up on demand by the command that owns them; finish()
+/// then rejects anything no command asked for, so typos never pass silently.
+class Args {
+public:
+    Args(int argc, char** argv, int first);
+
+    bool flag(std::string_view name);
+    std::string get(std::string_view name, const std::string& fallback);
+    std::uint64_t get_u64(std::string_view name, std::uint64_t fallback);
+    double get_double(std::string_view name, double fallback);
+
+    /// Remaining arguments that do not start with "--".
+    std::vector<std::string> positional();
+
+    /// Throws std::runtime_error naming the first unconsumed option.
+    void finish() const;
+
+private:
+    struct Token {
+        std::string text;
+        bool used = false;
+    };
+
+    Token* find(std::string_view name, std::string* inline_value);
+
+    std::vector<Token> tokens_;
+};
+
+} // namespace conway::cli
@@ -0,0 +1,264 @@
+#include "cli/commands.hpp"
+
+#include "conway/ltl_engine.hpp"
+#include "conway/mapped_file.hpp"
+#include "conway/packed_engine.hpp"
+#include "conway/pattern.hpp"
+#include "conway/snapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace conway::cli {
+
+namespace {
+
+struct Timing {
+    double seconds;
+    std::uint64_t population;
+};
+
+/// Best of `reps` runs of `gens` generations from `soup` with tile skipping
+/// off, so every run does the same amount of work.
+Timing time_kernel(const Grid& soup, const Rule& rule, const RowKernel& kernel,
+                   std::uint64_t gens, unsigned reps)
+{
+    Timing best{0, 0};
+    for (unsigned r = 0; r < reps; ++r) {
+        PackedEngine engine(soup.width(), soup.height(), rule);
+        engine.set_kernel(kernel);
+        engine.set_tile_skipping(false);
+        engine.current() = soup;
+        const auto start = std::chrono::steady_clock::now();
+        engine.run(gens);
+        const double secs = seconds_since(start);
+        if (r == 0 || secs < best.seconds)
+            best = {secs, engine.population()};
+    }
+    return best;
+}
+
+/// Specialised kernel vs the rule-table kernel for each rule that has one,
+/// then the decision-diagram kernel on isotropic non-totalistic rules,
+/// relative to the table kernel running B3/S23.
+void bench_rules(std::uint64_t width, std::uint64_t height, std::uint64_t gens, unsigned reps,
+                 std::uint64_t seed, const std::string& kernel)
+{
+    Grid soup(width, height);
+    soup.randomize(0.5, seed);
+    const double cells = static_cast<double>(soup.width()) * static_cast<double>(soup.height());
+
+    std::printf("rule kernels: %zux%zu soup, %llu generations, best of %u\n", soup.width(),
+                soup.height(), static_cast<unsigned long long>(gens), reps);
+    std::printf("%-14s %-8s %-9s %12s %14s %9s\n", "rule", "isa", "variant", "gen/s",
+                "cell-upd/s", "vs table");
+    auto print = [&](const Rule& rule, const RowKernel& k, const Timing& t, double table_seconds) {
+        const double rate = static_cast<double>(gens) / t.seconds;
+        std::printf("%-14s %-8s %-9s %12.1f %14.3e %8.2fx\n", rule.to_string().c_str(), k.name,
+                    k.variant, rate, rate * cells, table_seconds / t.seconds);
+    };
+    double life_table = 0;
+    for (const Rule& rule : {Rule::life(), Rule::highlife(), Rule::day_and_night()}) {
+        const RowKernel special = select_kernel(kernel, rule);
+        const RowKernel table = select_kernel(kernel, rule, false);
+        const Timing a = time_kernel(soup, rule, special, gens, reps);
+        const Timing b = time_kernel(soup, rule, table, gens, reps);
+        if (a.population != b.population)
+            throw std::runtime_error("kernels disagree on " + rule.to_string());
+        if (rule.is_life())
+            life_table = b.seconds;
+        print(rule, special, a, b.seconds);
+        print(rule, table, b, b.seconds);
+    }
+    for (const char* text : {"B2-a/S12", "B3/S2-i34q", "B3-cnqy/S234"}) {
+        const Rule rule = Rule::parse(text);
+        const RowKernel k = select_kernel(kernel, rule);
+        print(rule, k, time_kernel(soup, rule, k, gens, reps), life_table);
+    }
+}
+
+/// Larger than Life at ranges 1, 5 and 10 for both neighbourhoods. With
+/// sliding-window counts the rate should hardly depend on the range.
+void bench_ltl(std::uint64_t size, std::uint64_t gens, unsigned reps, std::uint64_t seed)
+{
+    Grid soup(size, size);
+    soup.randomize(0.5, seed);
+    const double cells = static_cast<double>(soup.width()) * static_cast<double>(soup.height());
+
+    std::printf("\nLarger than Life: %zux%zu soup, %llu generations, best of %u\n", soup.width(),
+                soup.height(), static_cast<unsigned long long>(gens), reps);
+    std::printf("%-36s %6s %12s %14s %9s\n", "rule", "cells", "gen/s", "cell-upd/s", "vs R1");
+    const char* rules[2][3] = {
+        {"R1,C0,M0,S2..3,B3..3,NM", "R5,C0,M1,S34..58,B34..45,NM", "R10,C0,M1,S123..212,B123..170,NM"},
+        {"R1,C0,M0,S1..2,B2..2,NN", "R5,C0,M1,S20..33,B20..26,NN", "R10,C0,M1,S70..120,B70..95,NN"},
+    };
+    for (const auto& family : rules) {
+        double r1_seconds = 0;
+        for (const char* text : family) {
+            const LtlRule rule = LtlRule::parse(text);
+            double best = 0;
+            for (unsigned r = 0; r < reps; ++r) {
+                LtlEngine engine(soup.width(), soup.height(), rule);
+                for (std::size_t y = 0; y < soup.height(); ++y)
+                    for (std::size_t x = 0; x < soup.width(); ++x)
+                        if (soup.get(x, y))
+                            engine.set_state(x, y, 1);
+                const auto start = std::chrono::steady_clock::now();
+                engine.run(gens);
+                const double secs = seconds_since(start);
+                if (r == 0 || secs < best)
+                    best = secs;
+            }
+            if (rule.range == 1)
+                r1_seconds = best;
+            const double rate = static_cast<double>(gens) / best;
+            std::printf("%-36s %6u %12.1f %14.3e %8.2fx\n", rule.to_string().c_str(),
+                        rule.neighbourhood_size(), rate, rate * cells, r1_seconds / best);
+        }
+    }
+}
+
+/// Save and load times of the board after `gens` generations of a soup as
+/// RLE and as a binary snapshot, raw and compressed. Rates are in board
+/// megabytes (one bit per cell) per second, so the formats compare
+/// directly; loads read the file just written, from the page cache.
+void bench_snapshots(std::uint64_t width, std::uint64_t height, std::uint64_t gens, unsigned reps,
+                     std::uint64_t seed)
+{
+    PackedEngine engine(width, height);
+    engine.current().randomize(0.5, seed);
+    engine.run(gens);
+    const Grid& board = engine.current();
+    const double board_mb = static_cast<double>(board.width()) * static_cast<double>(board.height()) / 8e6;
+
+    std::printf("\nsnapshots: %zux%zu board after %llu generations (population %llu), best of %u\n",
+                board.width(), board.height(), static_cast<unsigned long long>(gens),
+                static_cast<unsigned long long>(engine.population()), reps);
+    std::printf("%-16s %10s %8s %12s %12s\n", "format", "file MB", "ratio", "save MB/s", "load MB/s");
+    for (const SaveFormat format : {SaveFormat::rle, SaveFormat::snapshot, SaveFormat::compressed}) {
+        RoundTrip best{};
+        for (unsigned r = 0; r < reps; ++r) {
+            const RoundTrip t = time_round_trip(engine, format);
+            if (r == 0 || t.save_seconds < best.save_seconds)
+                best.save_seconds = t.save_seconds;
+            if (r == 0 || t.load_seconds < best.load_seconds)
+                best.load_seconds = t.load_seconds;
+            best.bytes = t.bytes;
+        }
+        std::printf("%-16s %10.2f %7.2fx %12.1f %12.1f\n", format_name(format),
+                    static_cast<double>(best.bytes) / 1e6, board_mb * 1e6 / static_cast<double>(best.bytes),
+                    board_mb / best.save_seconds, board_mb / best.load_seconds);
+    }
+}
+
+/// A new, empty file in the temporary directory, removed when this goes
+/// out of scope, however that happens.
+class TempFile {
+public:
+    TempFile()
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "bash-conway-XXXXXX").string();
+        const int fd = ::mkstemp(path.data());
+        if (fd < 0)
+            throw std::runtime_error("cannot create a temporary file in " + path);
+        ::close(fd);
+        path_ = std::move(path);
+    }
+    ~TempFile()
+    {
+        std::error_code ignored;
+        std::filesystem::remove(path_, ignored);
+    }
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+} // namespace
+
+const char* format_name(SaveFormat format)
+{
+    switch (format) {
+    case SaveFormat::rle:
+        return "rle";
+    case SaveFormat::snapshot:
+        return "snapshot";
+    case SaveFormat::compressed:
+        return "snapshot+sparse";
+    }
+    return "?";
+}
+
+RoundTrip time_round_trip(const PackedEngine& engine, SaveFormat format)
+{
+    const Grid& board = engine.current();
+    const TempFile temp;
+    RoundTrip t{};
+
+    auto start = std::chrono::steady_clock::now();
+    BufferedWriter out(temp.path());
+    if (format == SaveFormat::rle)
+        write_rle(out, board, engine.rule());
+    else
+        write_snapshot(out, board, engine.rule(), engine.generation(), format == SaveFormat::compressed);
+    out.close();
+    t.save_seconds = seconds_since(start);
+    t.bytes = out.bytes_written();
+
+    Grid loaded(board.width(), board.height());
+    start = std::chrono::steady_clock::now();
+    {
+        MappedFile file(temp.path());
+        if (format == SaveFormat::rle) {
+            GridSink sink(loaded, 0, 0);
+            read_rle(file.view(), sink);
+        } else {
+            Snapshot(file).load(loaded);
+        }
+    }
+    t.load_seconds = seconds_since(start);
+
+    // RLE keeps only the bounding box, so compare cell counts; a snapshot
+    // must come back word for word.
+    const bool same = format == SaveFormat::rle
+        ? loaded.population() == board.population()
+        : std::equal(loaded.data(), loaded.data() + loaded.word_count(), board.data());
+    if (!same)
+        throw std::runtime_error(std::string(format_name(format)) + " round trip changed the board");
+    return t;
+}
+
+int bench(Args& args)
+{
+    if (args.flag("suite"))
+        return bench_suite(args);
+    const std::uint64_t width = args.get_u64("width", 2048);
+    const std::uint64_t height = args.get_u64("height", 2048);
+    const std::uint64_t gens = args.get_u64("gens", 200);
+    const std::uint64_t reps = args.get_u64("reps", 3);
+    const std::uint64_t seed = args.get_u64("seed", 1);
+    const std::string kernel = args.get("kernel", "auto");
+    const std::uint64_t ltl_size = args.get_u64("ltl-size", 4096);
+    const std::uint64_t ltl_gens = args.get_u64("ltl-gens", 20);
+    args.finish();
+    if (reps == 0 || gens == 0 || ltl_gens == 0)
+        throw std::runtime_error("--gens, --ltl-gens and --reps must be positive");
+
+    bench_rules(width, height, gens, static_cast<unsigned>(reps), seed, kernel);
+    bench_ltl(ltl_size, ltl_gens, static_cast<unsigned>(reps), seed);
+    bench_snapshots(width, height, gens, static_cast<unsigned>(reps), seed);
+    return 0;
+}
+
+} // namespace conway::cli
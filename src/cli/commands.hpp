@@ -0,0 +1,43 @@
+#pragma once
+
+#include "cli/args.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+namespace conway {
+class PackedEngine;
+}
+
+namespace conway::cli {
+
+/// Each command consumes its own options from `args` and returns an exit code.
+int run(Args& args);
+int bench(Args& args);
+/// `bench --suite`: the fixed corpus across engines and board sizes.
+int bench_suite(Args& args);
+int verify(Args& args);
+/// Batch soup search: many small soups run to stabilisation on all cores.
+int search(Args& args);
+
+enum class SaveFormat { rle, snapshot, compressed };
+
+const char* format_name(SaveFormat format);
+
+/// One save of a board to a file and one load back.
+struct RoundTrip {
+    double save_seconds;
+    double load_seconds;
+    std::uint64_t bytes;
+};
+
+/// Saves `engine`'s board in `format` to a fresh temporary file, loads it
+/// back and removes the file. Throws if the board does not come back.
+RoundTrip time_round_trip(const PackedEngine& engine, SaveFormat format);
+
+inline double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace conway::cli
@@ -0,0 +1,94 @@
+#include "cli/corpus.hpp"
+
+#include "conway/grid.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+namespace conway::cli {
+
+namespace {
+
+constexpr std::string_view kRPentomino = "x = 3, y = 3\nb2o$2o$bo!\n";
+constexpr std::string_view kAcorn = "x = 7, y = 3\nbo$3bo$2o2b3o!\n";
+constexpr std::string_view kGosperGun =
+    "x = 36, y = 9\n"
+    "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$2o8bo3bob2o4bobo$"
+    "10bo5bo7bo$11bo3bo$12b2o!\n";
+constexpr std::string_view kMax =
+    "x = 27, y = 27\n"
+    "18bo8b$17b3o7b$12b3o4b2o6b$11bo2b3o2bob2o4b$10bo3bobo2bobo5b$10bo4bobobobob2o2b$"
+    "12bo4bobo3b2o2b$4o5bobo4bo3bob3o2b$o3b2obob3ob2o9b2ob$o5b2o5bo13b$"
+    "bo2b2obo2bo2bob2o10b$7bobobobobobo5b4o$bo2b2obo2bo2bo2b2obob2o3bo$"
+    "o5b2o3bobobo3b2o5bo$o3b2obob2o2bo2bo2bob2o2bo$4o5bobobobobobo7b$"
+    "10b2obo2bo2bob2o2bob$13bo5b2o5bo$b2o9b2ob3obob2o3bo$2b3obo3bo4bobo5b4o$"
+    "2b2o3bobo4bo12b$2b2obobobobo4bo10b$5bobo2bobo3bo10b$4b2obo2b3o2bo11b$"
+    "6b2o4b3o12b$7b3o17b$8bo!\n";
+
+/// Gun spacing along the anti-diagonal, and the gap left at the board
+/// edges; the gun is 36 x 9.
+constexpr std::int64_t kGunStep = 48;
+constexpr std::int64_t kGunMargin = 8;
+
+void emit_centred(std::string_view rle, std::uint64_t width, std::uint64_t height, CellSink& sink)
+{
+    const PatternInfo info = read_pattern_info(rle);
+    OffsetSink centred(sink, (static_cast<std::int64_t>(width) - info.width) / 2,
+                       (static_cast<std::int64_t>(height) - info.height) / 2);
+    read_rle(rle, centred);
+}
+
+} // namespace
+
+const std::vector<std::string_view>& corpus_names()
+{
+    static const std::vector<std::string_view> names = {"soup", "r-pentomino", "acorn", "gun-array",
+                                                        "max"};
+    return names;
+}
+
+void emit_soup(std::uint64_t width, std::uint64_t height, double density, std::uint64_t seed,
+               CellSink& sink)
+{
+    Grid soup(width, height);
+    soup.randomize(density, seed);
+    for (std::size_t y = 0; y < soup.height(); ++y)
+        for (std::size_t i = 0; i < soup.words_per_row(); ++i) {
+            std::uint64_t w = soup.row(y)[i];
+            while (w) {
+                const int start = std::countr_zero(w);
+                const int len = std::countr_one(w >> start);
+                sink.live_run(static_cast<std::int64_t>(i * 64) + start, static_cast<std::int64_t>(y), len);
+                w = len == 64 ? 0 : w & ~(((std::uint64_t{1} << len) - 1) << start);
+            }
+        }
+}
+
+void emit_corpus(std::string_view name, std::uint64_t width, std::uint64_t height,
+                 std::uint64_t seed, CellSink& sink)
+{
+    if (name == "soup") {
+        emit_soup(width, height, 0.5, seed, sink);
+    } else if (name == "r-pentomino") {
+        emit_centred(kRPentomino, width, height, sink);
+    } else if (name == "acorn") {
+        emit_centred(kAcorn, width, height, sink);
+    } else if (name == "max") {
+        emit_centred(kMax, width, height, sink);
+    } else if (name == "gun-array") {
+        // Guns from the bottom left to the top right, each firing south-east,
+        // so no stream crosses another gun until it wraps round the torus.
+        const std::int64_t side = static_cast<std::int64_t>(std::min(width, height));
+        const std::int64_t guns = std::max<std::int64_t>(1, (side - 2 * kGunMargin - 36) / kGunStep + 1);
+        for (std::int64_t i = 0; i < guns; ++i) {
+            OffsetSink gun(sink, kGunMargin + i * kGunStep, side - kGunMargin - 9 - i * kGunStep);
+            read_rle(kGosperGun, gun);
+        }
+    } else {
+        throw std::runtime_error("unknown corpus pattern '" + std::string(name) + "'");
+    }
+}
+
+} // namespace conway::cli
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "conway/pattern.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace conway::cli {
+
+/// Shifts every run by a fixed offset before passing it on.
+class OffsetSink : public CellSink {
+public:
+    OffsetSink(CellSink& sink, std::int64_t dx, std::int64_t dy) : sink_(sink), dx_(dx), dy_(dy) {}
+    void live_run(std::int64_t x, std::int64_t y, std::int64_t length) override
+    {
+        sink_.live_run(x + dx_, y + dy_, length);
+    }
+    void state_run(std::int64_t x, std::int64_t y, std::int64_t length, unsigned state) override
+    {
+        sink_.state_run(x + dx_, y + dy_, length, state);
+    }
+
+private:
+    CellSink& sink_;
+    std::int64_t dx_;
+    std::int64_t dy_;
+};
+
+/// The fixed starting patterns of `bench --suite`: "soup" (50% random),
+/// "r-pentomino", "acorn", "gun-array" (Gosper guns along an anti-diagonal,
+/// their streams parallel) and "max" (Tim Coe's spacefiller, quadratic
+/// growth).
+const std::vector<std::string_view>& corpus_names();
+
+/// Emits corpus pattern `name` into `sink`, laid out for a width x height
+/// board with (0, 0) at the top left: the soup fills the box, the gun array
+/// spans its diagonal and the rest are centred. Throws std::runtime_error
+/// for an unknown name.
+void emit_corpus(std::string_view name, std::uint64_t width, std::uint64_t height,
+                 std::uint64_t seed, CellSink& sink);
+
+/// Emits a width x height random soup of the given density as runs.
+void emit_soup(std::uint64_t width, std::uint64_t height, double density, std::uint64_t seed,
+               CellSink& sink);
+
+} // namespace conway::cli
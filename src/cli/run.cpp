@@ -0,0 +1,715 @@
+#include "cli/commands.hpp"
+#include "cli/corpus.hpp"
+
+#include "conway/density_pyramid.hpp"
+#include "conway/generations_engine.hpp"
+#include "conway/hashlife.hpp"
+#include "conway/ltl_engine.hpp"
+#include "conway/mapped_file.hpp"
+#include "conway/packed_engine.hpp"
+#include "conway/pattern.hpp"
+#include "conway/period.hpp"
+#include "conway/snapshot.hpp"
+#include "conway/sparse_engine.hpp"
+#include "conway/terminal_renderer.hpp"
+#include "conway/triple_buffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+namespace conway::cli {
+
+namespace {
+
+/// A pattern file mapped into memory. Macrocell files are parsed to their
+/// node list up front because the root size is only known at the end;
+/// snapshots are read in place from the mapping.
+struct PatternSource {
+    std::unique_ptr<MappedFile> file;
+    std::unique_ptr<Snapshot> snapshot;
+    bool macrocell = false;
+    std::vector<MacrocellNode> nodes;
+    PatternInfo info;
+    double parse_seconds = 0;
+};
+
+struct RunOptions {
+    std::uint64_t width;
+    std::uint64_t height;
+    std::uint64_t gens;
+    std::uint64_t seed;
+    double density;
+    std::string pattern_path;
+    PatternSource pattern;
+    std::string out_path;
+    /// Store sparse tiles compressed in a .snap --out.
+    bool compress;
+    std::uint64_t report_every;
+    /// Longest period to watch for; 0 runs all `gens` generations.
+    std::uint64_t period;
+    /// Draw the board on the terminal `fps` times a second, in a
+    /// screen_columns x screen_rows area (status line included).
+    bool render;
+    std::size_t screen_columns;
+    std::size_t screen_rows;
+    double fps;
+    TerminalRenderer::Glyphs glyphs;
+    /// Board cells per rendered cell side, a power of two; 0 fits the whole
+    /// board in view.
+    std::uint64_t zoom;
+    std::uint64_t threads;
+    PackedEngine::Schedule schedule;
+    bool no_skip;
+    Rule rule;
+    /// Set instead of `rule` for Larger than Life rules.
+    std::optional<LtlRule> ltl;
+};
+
+void print_rate(std::uint64_t gens, double secs, double cells)
+{
+    std::printf("elapsed:     %.3f s\n", secs);
+    if (secs > 0) {
+        std::printf("gen/s:       %.1f\n", static_cast<double>(gens) / secs);
+        if (cells > 0)
+            std::printf("cell-upd/s:  %.3e\n", cells * static_cast<double>(gens) / secs);
+    }
+}
+
+/// True when `path` asks for macrocell output rather than RLE.
+bool wants_macrocell(const std::string& path)
+{
+    return path.size() >= 3 && path.compare(path.size() - 3, 3, ".mc") == 0;
+}
+
+/// True when `path` asks for a binary snapshot.
+bool wants_snapshot(const std::string& path)
+{
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".snap") == 0;
+}
+
+/// Opens --out, lets `write` stream into it and reports the write rate.
+template <class Write>
+void write_output(const std::string& path, Write&& write)
+{
+    const auto start = std::chrono::steady_clock::now();
+    BufferedWriter out(path);
+    write(out);
+    out.close();
+    const double secs = seconds_since(start);
+    const double mb = static_cast<double>(out.bytes_written()) / 1e6;
+    std::printf("written:     %.1f MB to %s in %.3f s (%.1f MB/s)\n", mb, path.c_str(), secs,
+                secs > 0 ? mb / secs : 0.0);
+}
+
+void print_load(const PatternSource& src, double secs)
+{
+    const double mb = static_cast<double>(src.file->size()) / 1e6;
+    std::printf("loaded:      %.1f MB %s in %.3f s (%.1f MB/s)\n", mb,
+                src.snapshot ? "snapshot" : src.macrocell ? "macrocell" : "RLE", secs, secs > 0 ? mb / secs : 0.0);
+}
+
+/// Streams the pattern's live runs into `sink` and reports parse throughput.
+void load_pattern(const PatternSource& src, CellSink& sink)
+{
+    const auto start = std::chrono::steady_clock::now();
+    if (src.macrocell)
+        emit_macrocell(src.nodes, sink);
+    else
+        read_rle(src.file->view(), sink);
+    print_load(src, src.parse_seconds + seconds_since(start));
+}
+
+/// Emits the random soup described by the options into `sink`.
+void load_soup(const RunOptions& opt, CellSink& sink)
+{
+    emit_soup(opt.width, opt.height, opt.density, opt.seed, sink);
+}
+
+/// The view window of one completed generation, as handed from the
+/// stepping thread to the render thread.
+struct ViewFrame {
+    Grid window;
+    std::uint64_t generation = 0;
+    std::uint64_t population = 0;
+};
+
+/// Draws the middle of the board on its own thread at a fixed frame rate.
+///
+/// Zoomed out, each rendered cell stands for a zoom x zoom block, live if
+/// any cell in it is, and the window comes from a DensityPyramid kept up to
+/// date every generation.
+///
+/// The stepping thread copies the view window out of the generation it
+/// just completed, a few times per frame interval, and publishes it
+/// through a triple buffer; the render thread wakes `fps` times a second,
+/// takes whatever is newest and draws it. Neither ever waits for the other,
+/// so a slow terminal costs frames, not generations, and a fast simulation
+/// does not spend its time copying windows nobody will see.
+class LiveView {
+public:
+    /// Shows `board`, whose run starts at generation `first`.
+    LiveView(const RunOptions& opt, const Grid& board, std::uint64_t first)
+        : renderer_(STDOUT_FILENO, opt.screen_columns, opt.screen_rows - 1, opt.glyphs)
+        , zoom_(pick_zoom(opt.zoom, board, renderer_.columns() * renderer_.cell_width(),
+                          renderer_.rows() * renderer_.cell_height()))
+        , across_(DensityPyramid::blocks(board.width(), zoom_))
+        , down_(DensityPyramid::blocks(board.height(), zoom_))
+        , width_(std::min(renderer_.columns() * renderer_.cell_width(), across_))
+        , height_(std::min(renderer_.rows() * renderer_.cell_height(), down_))
+        , x0_((across_ - width_) / 2)
+        , y0_((down_ - height_) / 2)
+        , frame_interval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double>(1.0 / opt.fps)))
+        , publish_interval_(frame_interval_ / kPublishesPerFrame)
+        , first_generation_(first)
+        , frames_(ViewFrame{Grid(width_, height_), first, 0})
+    {
+        thread_ = std::thread([this] { loop(); });
+    }
+
+    ~LiveView() { stop(); }
+
+    /// Stepping thread: called after every generation `engine` completes.
+    void publish(const PackedEngine& engine)
+    {
+        if (zoom_ > 1)
+            pyramid_.update(engine);
+        const auto now = std::chrono::steady_clock::now();
+        if (now < next_publish_)
+            return;
+        next_publish_ = now + publish_interval_;
+        share(engine);
+    }
+
+    /// Publishes the final generation, lets the render thread draw it and
+    /// stops.
+    void finish(const PackedEngine& engine)
+    {
+        if (zoom_ > 1)
+            pyramid_.update(engine);
+        share(engine);
+        stop();
+    }
+
+    const TerminalRenderer& renderer() const { return renderer_; }
+    /// Board cells in view, at 1 / zoom() scale.
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+    std::size_t zoom() const { return zoom_; }
+
+private:
+    /// Views published per frame interval, so the frame drawn is at most
+    /// a quarter of an interval behind the simulation.
+    static constexpr int kPublishesPerFrame = 4;
+
+    void share(const PackedEngine& engine)
+    {
+        ViewFrame& f = frames_.back();
+        if (zoom_ == 1)
+            f.window.copy_window(engine.current(), x0_, y0_);
+        else
+            pyramid_.downsample(engine, zoom_, x0_, y0_, f.window);
+        f.generation = engine.generation();
+        f.population = engine.population();
+        frames_.publish();
+    }
+
+    /// Lets the render thread draw the last published generation and stop.
+    void stop()
+    {
+        if (!thread_.joinable())
+            return;
+        done_.store(true, std::memory_order_release);
+        thread_.join();
+    }
+
+    /// `zoom`, or with 0 the least power of two that fits the board into
+    /// a columns x rows view, capped where one cell covers the board.
+    static std::size_t pick_zoom(std::uint64_t zoom, const Grid& board, std::size_t columns, std::size_t rows)
+    {
+        auto fits = [&](std::size_t z, std::size_t c, std::size_t r) {
+            return DensityPyramid::blocks(board.width(), z) <= c && DensityPyramid::blocks(board.height(), z) <= r;
+        };
+        std::size_t z = 1;
+        while (!(zoom ? z >= zoom : fits(z, columns, rows)) && !fits(z, 1, 1))
+            z *= 2;
+        return z;
+    }
+
+    void loop()
+    {
+        using Clock = std::chrono::steady_clock;
+        auto next = Clock::now();
+        auto rate_start = next;
+        std::uint64_t rate_gen = first_generation_, rate_frames = 0;
+        double gen_rate = 0, frame_rate = 0;
+        std::size_t frame_bytes = 0;
+        for (;;) {
+            // Read the flag first, so the acquire below sees the final
+            // publish once it is set.
+            const bool last = done_.load(std::memory_order_acquire);
+            if (frames_.acquire()) {
+                const ViewFrame& f = frames_.front();
+                const auto now = Clock::now();
+                const double dt = std::chrono::duration<double>(now - rate_start).count();
+                if (dt >= 0.5) {
+                    gen_rate = static_cast<double>(f.generation - rate_gen) / dt;
+                    frame_rate = static_cast<double>(renderer_.frames() - rate_frames) / dt;
+                    rate_start = now;
+                    rate_gen = f.generation;
+                    rate_frames = renderer_.frames();
+                }
+                char status[160];
+                std::snprintf(status, sizeof status,
+                              "gen %llu  pop %llu  zoom 1:%zu  sim %.0f gen/s  view %.1f fps  %zu bytes/frame",
+                              static_cast<unsigned long long>(f.generation),
+                              static_cast<unsigned long long>(f.population), zoom_, gen_rate, frame_rate,
+                              frame_bytes);
+                frame_bytes = renderer_.render(f.window, 0, 0, status);
+            }
+            if (last)
+                return;
+            next += frame_interval_;
+            const auto now = Clock::now();
+            if (next < now)
+                next = now;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    TerminalRenderer renderer_;
+    std::size_t zoom_;
+    /// Blocks of zoom_ cells across and down the board.
+    std::size_t across_;
+    std::size_t down_;
+    std::size_t width_;
+    std::size_t height_;
+    std::size_t x0_;
+    std::size_t y0_;
+    std::chrono::steady_clock::duration frame_interval_;
+    std::chrono::steady_clock::duration publish_interval_;
+    std::chrono::steady_clock::time_point next_publish_{};
+    DensityPyramid pyramid_;
+    std::uint64_t first_generation_;
+    TripleBuffer<ViewFrame> frames_;
+    std::atomic<bool> done_{false};
+    std::thread thread_;
+};
+
+int run_packed(const RunOptions& opt, std::string_view kernel)
+{
+    PackedEngine engine(opt.width, opt.height, opt.rule, kernel);
+    Grid& board = engine.current();
+    if (opt.pattern.snapshot) {
+        // Resume exactly where the snapshot was taken.
+        const auto load_start = std::chrono::steady_clock::now();
+        opt.pattern.snapshot->load(board);
+        engine.set_generation(opt.pattern.snapshot->generation());
+        print_load(opt.pattern, seconds_since(load_start));
+    } else if (opt.pattern_path.empty()) {
+        board.randomize(opt.density, opt.seed);
+    } else {
+        // Centre the pattern on the board.
+        const PatternInfo& info = opt.pattern.info;
+        GridSink sink(board, (static_cast<std::int64_t>(board.width()) - info.width) / 2,
+                      (static_cast<std::int64_t>(board.height()) - info.height) / 2);
+        load_pattern(opt.pattern, sink);
+    }
+
+    engine.set_tile_skipping(!opt.no_skip);
+    engine.set_threads(opt.threads);
+    engine.set_schedule(opt.schedule);
+
+    std::optional<PeriodDetector> detector;
+    std::size_t period = 0;
+    if (opt.period)
+        detector.emplace(static_cast<std::size_t>(opt.period));
+    std::unique_ptr<LiveView> view;
+    if (opt.render) {
+        view = std::make_unique<LiveView>(opt, board, engine.generation());
+        view->publish(engine);
+    }
+    // A resumed run starts at the snapshot's generation; rates count only
+    // the generations stepped here.
+    const std::uint64_t first_gen = engine.generation();
+    const auto start = std::chrono::steady_clock::now();
+    if (opt.report_every == 0 && !detector && !view) {
+        engine.run(opt.gens);
+    } else {
+        if (detector)
+            detector->observe(engine.hash(), engine.population());
+        for (std::uint64_t g = 0; g < opt.gens && !period; ++g) {
+            engine.step();
+            if (opt.report_every && engine.generation() % opt.report_every == 0)
+                std::printf("gen %llu  pop %llu  active tiles %zu/%zu\n",
+                            static_cast<unsigned long long>(engine.generation()),
+                            static_cast<unsigned long long>(engine.population()),
+                            engine.active_tiles(), engine.tile_count());
+            if (detector)
+                period = detector->observe(engine.hash(), engine.population());
+            if (view)
+                view->publish(engine);
+        }
+    }
+    const double secs = seconds_since(start);
+    std::uint64_t frames = 0, view_bytes = 0, full_bytes = 0;
+    std::size_t view_width = 0, view_height = 0, zoom = 1;
+    if (view) {
+        zoom = view->zoom();
+        view->finish(engine);
+        view_width = view->width();
+        view_height = view->height();
+        frames = view->renderer().frames();
+        view_bytes = view->renderer().bytes();
+        full_bytes = view->renderer().full_bytes();
+        view.reset();
+    }
+    const std::uint64_t gens = engine.generation() - first_gen;
+
+    std::printf("engine:      packed\n");
+    std::printf("board:       %zux%zu\n", board.width(), board.height());
+    std::printf("rule:        %s\n", engine.rule().to_string().c_str());
+    std::printf("kernel:      %s (%s)\n", engine.kernel().name, engine.kernel().variant);
+    std::printf("generation:  %llu\n", static_cast<unsigned long long>(engine.generation()));
+    std::printf("population:  %llu\n", static_cast<unsigned long long>(engine.population()));
+    std::int64_t x0, y0, x1, y1;
+    if (engine.bounds(x0, y0, x1, y1))
+        std::printf("bounds:      x %lld..%lld, y %lld..%lld\n", static_cast<long long>(x0),
+                    static_cast<long long>(x1 - 1), static_cast<long long>(y0), static_cast<long long>(y1 - 1));
+    std::printf("tiles:       %zu active of %zu in the last step\n", engine.active_tiles(),
+                engine.tile_count());
+    if (period)
+        std::printf("period:      %zu, repeating since generation %llu (stopped early)\n", period,
+                    static_cast<unsigned long long>(engine.generation() - period));
+    else if (detector)
+        std::printf("period:      none up to %zu\n", detector->max_period());
+    print_rate(gens, secs, static_cast<double>(board.width()) * static_cast<double>(board.height()));
+    if (frames) {
+        const double sent = static_cast<double>(view_bytes) / static_cast<double>(frames);
+        const double full = static_cast<double>(full_bytes) / static_cast<double>(frames);
+        std::printf("render:      %llu frames of %zux%zu cells at 1:%zu, %.0f bytes/frame (full redraws: %.0f, %.1fx more)\n",
+                    static_cast<unsigned long long>(frames), view_width, view_height, zoom, sent, full,
+                    sent > 0 ? full / sent : 0.0);
+    }
+    if (engine.threads() > 1) {
+        std::printf("threads:     %zu (%s)\n", engine.threads(),
+                    opt.schedule == PackedEngine::Schedule::steal ? "work stealing" : "bands");
+        const auto& stats = engine.worker_stats();
+        for (std::size_t i = 0; i < stats.size(); ++i)
+            std::printf("  worker %2zu  busy %.3f s (%4.1f%%)  idle %.3f s  tiles %llu  steals %llu\n",
+                        i, stats[i].busy_seconds,
+                        secs > 0 ? 100.0 * stats[i].busy_seconds / secs : 0.0,
+                        stats[i].idle_seconds, static_cast<unsigned long long>(stats[i].tiles),
+                        static_cast<unsigned long long>(stats[i].steals));
+    }
+
+    if (!opt.out_path.empty())
+        write_output(opt.out_path, [&](BufferedWriter& out) {
+            if (wants_snapshot(opt.out_path))
+                write_snapshot(out, board, engine.rule(), engine.generation(), opt.compress);
+            else
+                write_rle(out, board, engine.rule());
+        });
+    return 0;
+}
+
+int run_generations(const RunOptions& opt, std::string_view kernel)
+{
+    GenerationsEngine engine(opt.width, opt.height, opt.rule, kernel);
+    if (opt.pattern_path.empty()) {
+        engine.alive().randomize(opt.density, opt.seed);
+    } else {
+        const PatternInfo& info = opt.pattern.info;
+        GenerationsSink sink(engine, (static_cast<std::int64_t>(engine.width()) - info.width) / 2,
+                             (static_cast<std::int64_t>(engine.height()) - info.height) / 2);
+        load_pattern(opt.pattern, sink);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (opt.report_every == 0) {
+        engine.run(opt.gens);
+    } else {
+        for (std::uint64_t g = 0; g < opt.gens; ++g) {
+            engine.step();
+            if (engine.generation() % opt.report_every == 0)
+                std::printf("gen %llu  pop %llu  decaying %llu\n",
+                            static_cast<unsigned long long>(engine.generation()),
+                            static_cast<unsigned long long>(engine.population()),
+                            static_cast<unsigned long long>(engine.decaying()));
+        }
+    }
+    const double secs = seconds_since(start);
+
+    std::printf("engine:      generations\n");
+    std::printf("board:       %zux%zu\n", engine.width(), engine.height());
+    std::printf("rule:        %s\n", engine.rule().to_string().c_str());
+    std::printf("kernel:      %s (%s)\n", engine.kernel().name, engine.kernel().variant);
+    std::printf("planes:      %zu bits per cell\n", engine.planes());
+    std::printf("generation:  %llu\n", static_cast<unsigned long long>(engine.generation()));
+    std::printf("population:  %llu\n", static_cast<unsigned long long>(engine.population()));
+    std::printf("decaying:    %llu\n", static_cast<unsigned long long>(engine.decaying()));
+    print_rate(opt.gens, secs, static_cast<double>(engine.width()) * static_cast<double>(engine.height()));
+
+    if (!opt.out_path.empty())
+        write_output(opt.out_path, [&](BufferedWriter& out) { engine.write_rle(out); });
+    return 0;
+}
+
+int run_ltl(const RunOptions& opt)
+{
+    LtlEngine engine(opt.width, opt.height, *opt.ltl);
+    if (opt.pattern_path.empty()) {
+        LtlSink sink(engine, 0, 0);
+        load_soup(opt, sink);
+    } else {
+        const PatternInfo& info = opt.pattern.info;
+        LtlSink sink(engine, (static_cast<std::int64_t>(engine.width()) - info.width) / 2,
+                     (static_cast<std::int64_t>(engine.height()) - info.height) / 2);
+        load_pattern(opt.pattern, sink);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (opt.report_every == 0) {
+        engine.run(opt.gens);
+    } else {
+        for (std::uint64_t g = 0; g < opt.gens; ++g) {
+            engine.step();
+            if (engine.generation() % opt.report_every == 0)
+                std::printf("gen %llu  pop %llu\n", static_cast<unsigned long long>(engine.generation()),
+                            static_cast<unsigned long long>(engine.population()));
+        }
+    }
+    const double secs = seconds_since(start);
+
+    std::printf("engine:      ltl\n");
+    std::printf("board:       %zux%zu\n", engine.width(), engine.height());
+    std::printf("rule:        %s\n", engine.rule().to_string().c_str());
+    std::printf("neighbours:  %u cells within range %u\n", engine.rule().neighbourhood_size(),
+                engine.rule().range);
+    std::printf("generation:  %llu\n", static_cast<unsigned long long>(engine.generation()));
+    std::printf("population:  %llu\n", static_cast<unsigned long long>(engine.population()));
+    if (engine.rule().states > 2)
+        std::printf("decaying:    %llu\n", static_cast<unsigned long long>(engine.decaying()));
+    print_rate(opt.gens, secs, static_cast<double>(engine.width()) * static_cast<double>(engine.height()));
+
+    if (!opt.out_path.empty())
+        write_output(opt.out_path, [&](BufferedWriter& out) { engine.write_rle(out); });
+    return 0;
+}
+
+int run_hashlife(const RunOptions& opt, std::size_t memory_limit)
+{
+    HashLife life(opt.rule, memory_limit);
+    HashLifeSink sink(life, 0, 0);
+    if (opt.pattern_path.empty()) {
+        load_soup(opt, sink);
+    } else if (opt.pattern.macrocell) {
+        const auto start = std::chrono::steady_clock::now();
+        life.load_macrocell(opt.pattern.nodes);
+        print_load(opt.pattern, opt.pattern.parse_seconds + seconds_since(start));
+    } else {
+        load_pattern(opt.pattern, sink);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    life.run(opt.gens);
+    const double secs = seconds_since(start);
+
+    std::printf("engine:      hashlife\n");
+    std::printf("rule:        %s\n", life.rule().to_string().c_str());
+    std::printf("generation:  %llu\n", static_cast<unsigned long long>(life.generation()));
+    std::printf("population:  %llu\n", static_cast<unsigned long long>(life.population()));
+    std::printf("nodes:       %zu (%.1f MB, %llu gc)\n", life.node_count(),
+                static_cast<double>(life.memory_bytes()) / 1e6,
+                static_cast<unsigned long long>(life.gc_runs()));
+    print_rate(opt.gens, secs, 0);
+
+    if (!opt.out_path.empty())
+        write_output(opt.out_path, [&](BufferedWriter& out) {
+            if (wants_macrocell(opt.out_path))
+                life.write_macrocell(out);
+            else
+                life.write_rle(out);
+        });
+    return 0;
+}
+
+int run_sparse(const RunOptions& opt)
+{
+    SparseEngine engine(opt.rule);
+    SparseSink sink(engine, 0, 0);
+    if (opt.pattern_path.empty())
+        load_soup(opt, sink);
+    else
+        load_pattern(opt.pattern, sink);
+
+    const auto start = std::chrono::steady_clock::now();
+    if (opt.report_every == 0) {
+        engine.run(opt.gens);
+    } else {
+        for (std::uint64_t g = 0; g < opt.gens; ++g) {
+            engine.step();
+            if (engine.generation() % opt.report_every == 0)
+                std::printf("gen %llu  pop %llu  tiles %zu  active %zu\n",
+                            static_cast<unsigned long long>(engine.generation()),
+                            static_cast<unsigned long long>(engine.population()),
+                            engine.tile_count(), engine.active_tiles());
+        }
+    }
+    const double secs = seconds_since(start);
+
+    std::printf("engine:      sparse\n");
+    std::printf("rule:        %s\n", engine.rule().to_string().c_str());
+    std::printf("generation:  %llu\n", static_cast<unsigned long long>(engine.generation()));
+    std::printf("population:  %llu\n", static_cast<unsigned long long>(engine.population()));
+    std::printf("tiles:       %zu allocated (%.1f MB), %zu active in the last step\n",
+                engine.tile_count(), static_cast<double>(engine.memory_bytes()) / 1e6,
+                engine.active_tiles());
+    print_rate(opt.gens, secs, 0);
+
+    if (!opt.out_path.empty())
+        write_output(opt.out_path, [&](BufferedWriter& out) { engine.write_rle(out); });
+    return 0;
+}
+
+} // namespace
+
+int run(Args& args)
+{
+    RunOptions opt;
+    opt.width = args.get_u64("width", 1024);
+    opt.height = args.get_u64("height", 1024);
+    opt.gens = args.get_u64("gens", 1000);
+    opt.seed = args.get_u64("seed", 1);
+    opt.density = args.get_double("density", 0.5);
+    opt.pattern_path = args.get("pattern", "");
+    opt.out_path = args.get("out", "");
+    opt.compress = args.flag("compress");
+    opt.report_every = args.get_u64("report-every", 0);
+    opt.period = args.get_u64("period", 0);
+    opt.render = args.flag("render");
+    opt.fps = args.get_double("fps", 60);
+    if (!(opt.fps > 0))
+        throw std::runtime_error("--fps must be positive");
+    TerminalRenderer::terminal_size(STDOUT_FILENO, opt.screen_columns, opt.screen_rows);
+    const std::string screen = args.get("screen", "");
+    if (!screen.empty()) {
+        const std::size_t x = screen.find('x');
+        opt.screen_columns = x == std::string::npos ? 0 : std::strtoull(screen.c_str(), nullptr, 10);
+        opt.screen_rows = x == std::string::npos ? 0 : std::strtoull(screen.c_str() + x + 1, nullptr, 10);
+        if (opt.screen_columns == 0 || opt.screen_rows < 2)
+            throw std::runtime_error("--screen wants COLUMNSxROWS, e.g. 120x40");
+    }
+    const std::string glyphs = args.get("glyphs", "cell");
+    if (glyphs == "cell")
+        opt.glyphs = TerminalRenderer::Glyphs::cell;
+    else if (glyphs == "half")
+        opt.glyphs = TerminalRenderer::Glyphs::half;
+    else if (glyphs == "braille")
+        opt.glyphs = TerminalRenderer::Glyphs::braille;
+    else
+        throw std::runtime_error("unknown glyphs '" + glyphs + "'");
+    const std::string zoom = args.get("zoom", "1");
+    opt.zoom = zoom == "fit" ? 0 : std::strtoull(zoom.c_str(), nullptr, 10);
+    if (zoom != "fit" && !std::has_single_bit(opt.zoom))
+        throw std::runtime_error("--zoom wants a power of two or 'fit'");
+    opt.no_skip = args.flag("no-skip");
+    opt.threads = args.get_u64("threads", 1);
+    const std::string schedule = args.get("schedule", "bands");
+    if (schedule == "bands")
+        opt.schedule = PackedEngine::Schedule::bands;
+    else if (schedule == "steal")
+        opt.schedule = PackedEngine::Schedule::steal;
+    else
+        throw std::runtime_error("unknown schedule '" + schedule + "'");
+    const std::string rule_text = args.get("rule", "");
+    std::string engine = args.get("engine", "");
+    const std::string kernel = args.get("kernel", "auto");
+    const bool print_kernel = args.flag("print-kernel");
+    const std::uint64_t hash_mem_mb = args.get_u64("hash-mem", 1024);
+    args.finish();
+
+    std::string pattern_rule;
+    if (!opt.pattern_path.empty()) {
+        PatternSource& src = opt.pattern;
+        src.file = std::make_unique<MappedFile>(opt.pattern_path);
+        if (Snapshot::is_snapshot(src.file->view())) {
+            src.snapshot = std::make_unique<Snapshot>(*src.file);
+            src.info.width = static_cast<std::int64_t>(src.snapshot->width());
+            src.info.height = static_cast<std::int64_t>(src.snapshot->height());
+            src.info.rule = src.snapshot->rule();
+            src.info.generation = src.snapshot->generation();
+            // A checkpoint is restored on a board of its own size.
+            opt.width = src.snapshot->width();
+            opt.height = src.snapshot->height();
+        } else {
+            src.macrocell = is_macrocell(src.file->view());
+            const auto start = std::chrono::steady_clock::now();
+            src.info = src.macrocell ? parse_macrocell(src.file->view(), src.nodes)
+                                     : read_pattern_info(src.file->view());
+            src.parse_seconds = seconds_since(start);
+        }
+        pattern_rule = src.info.rule;
+    }
+    const std::string& rule_source = !rule_text.empty() ? rule_text : pattern_rule;
+    if (LtlRule::is_ltl(rule_source)) {
+        opt.ltl = LtlRule::parse(rule_source);
+        if (engine.empty())
+            engine = "ltl";
+        else if (engine != "ltl")
+            throw std::runtime_error("Larger than Life rules need --engine ltl");
+    } else {
+        opt.rule = !rule_source.empty() ? Rule::parse(rule_source) : Rule::life();
+        if (engine.empty())
+            engine = opt.rule.generations() ? "generations" : "packed";
+        else if (engine == "ltl")
+            throw std::runtime_error("--engine ltl needs a Larger than Life rule such as R5,C0,M1,S34..58,B34..45,NM");
+    }
+    if (opt.period && engine != "packed")
+        throw std::runtime_error("--period needs the packed engine");
+    if (opt.render && engine != "packed")
+        throw std::runtime_error("--render needs the packed engine");
+    // Only the packed engine steps on more than one thread.
+    if (opt.threads != 1 && engine != "packed")
+        throw std::runtime_error("--threads needs the packed engine");
+    if (opt.schedule != PackedEngine::Schedule::bands && engine != "packed")
+        throw std::runtime_error("--schedule needs the packed engine");
+    if (opt.render && opt.report_every)
+        throw std::runtime_error("--render and --report-every both write to the terminal; pick one");
+    if (opt.pattern.snapshot && engine != "packed")
+        throw std::runtime_error("snapshots load into the packed engine");
+    if (wants_snapshot(opt.out_path) && engine != "packed")
+        throw std::runtime_error("snapshot output (.snap) needs the packed engine");
+    if (wants_macrocell(opt.out_path) && engine != "hashlife")
+        throw std::runtime_error("macrocell output (.mc) needs --engine hashlife");
+
+    if (print_kernel) {
+        if (opt.ltl)
+            throw std::runtime_error("Larger than Life rules do not use a row kernel");
+        const RowKernel k = select_kernel(kernel, opt.rule);
+        std::printf("%s (%s)\n", k.name, k.variant);
+        return 0;
+    }
+    if (engine == "packed")
+        return run_packed(opt, kernel);
+    if (engine == "generations")
+        return run_generations(opt, kernel);
+    if (engine == "ltl")
+        return run_ltl(opt);
+    if (engine == "hashlife")
+        return run_hashlife(opt, static_cast<std::size_t>(hash_mem_mb) << 20);
+    if (engine == "sparse")
+        return run_sparse(opt);
+    throw std::runtime_error("unknown engine '" + engine + "'");
+}
+
+} // namespace conway::cli
@@ -0,0 +1,243 @@
+#include "cli/commands.hpp"
+
+#include "conway/buffered_writer.hpp"
+#include "conway/census.hpp"
+#include "conway/period.hpp"
+#include "conway/random.hpp"
+#include "conway/sparse_engine.hpp"
+#include "conway/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace conway::cli {
+
+namespace {
+
+/// Soups handed to a worker per claim, so the shared counter is touched
+/// once per batch rather than once per soup.
+constexpr std::uint64_t kClaimSoups = 64;
+
+struct SearchOptions {
+    Rule rule;
+    std::uint64_t soups;
+    std::uint64_t side;
+    std::uint64_t seed;
+    std::uint64_t max_gens;
+    std::size_t max_period;
+    std::size_t window;
+    bool census;
+};
+
+/// What one worker saw. Workers only ever write their own tally; the
+/// tallies are summed after the pool joins.
+struct alignas(64) Tally {
+    std::uint64_t soups = 0;
+    std::uint64_t unsettled = 0;
+    std::uint64_t generations = 0;
+    std::uint64_t final_population = 0;
+    double soup_seconds = 0;
+    double census_seconds = 0;
+    /// Soups per settled period, indexed by period.
+    std::vector<std::uint64_t> periods;
+
+    Tally& operator+=(const Tally& t)
+    {
+        soups += t.soups;
+        unsettled += t.unsettled;
+        generations += t.generations;
+        final_population += t.final_population;
+        soup_seconds += t.soup_seconds;
+        census_seconds += t.census_seconds;
+        periods.resize(std::max(periods.size(), t.periods.size()));
+        for (std::size_t p = 0; p < t.periods.size(); ++p)
+            periods[p] += t.periods[p];
+        return *this;
+    }
+};
+
+/// Fills a side x side square from soup `index`'s own random stream, so a
+/// soup's contents do not depend on which worker ran it. The square is
+/// centred in a tile so that most soups start and settle in one tile.
+void plant_soup(SparseEngine& engine, std::uint64_t side, std::uint64_t seed, std::uint64_t index)
+{
+    SplitMix64 rng(seed + index * 0xd1b54a32d192ed03ull);
+    const auto origin = static_cast<std::int64_t>((SparseEngine::kTileSize - side) / 2);
+    for (std::uint64_t y = 0; y < side; ++y) {
+        const std::uint64_t bits = rng.next();
+        for (std::uint64_t x = 0; x < side; ++x)
+            if (bits >> x & 1)
+                engine.set_cell(origin + static_cast<std::int64_t>(x), origin + static_cast<std::int64_t>(y));
+    }
+}
+
+/// One worker: a private engine reused as the arena for every soup it runs,
+/// and a private stabilisation detector, census and tally.
+class SearchWorker {
+public:
+    explicit SearchWorker(const SearchOptions& opt)
+        : opt_(opt), engine_(opt.rule), settle_(opt.max_period, opt.window), census_(opt.rule, opt.max_period)
+    {
+        tally_.periods.assign(opt.max_period + 1, 0);
+    }
+
+    /// Runs soup `index` until its population settles or max_gens pass,
+    /// then takes the census of what is left.
+    void run_soup(std::uint64_t index)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        engine_.clear();
+        settle_.reset();
+        plant_soup(engine_, opt_.side, opt_.seed, index);
+        std::size_t period = settle_.observe(engine_.population());
+        while (!period && engine_.generation() < opt_.max_gens) {
+            engine_.step();
+            period = settle_.observe(engine_.population());
+        }
+        ++tally_.soups;
+        tally_.generations += engine_.generation();
+        tally_.final_population += engine_.population();
+        if (period)
+            ++tally_.periods[period];
+        else
+            ++tally_.unsettled;
+        if (opt_.census) {
+            const auto census_start = std::chrono::steady_clock::now();
+            census_.add(engine_);
+            tally_.census_seconds += seconds_since(census_start);
+        }
+        tally_.soup_seconds += seconds_since(start);
+    }
+
+    const Tally& tally() const { return tally_; }
+    const Census& census() const { return census_; }
+
+private:
+    const SearchOptions& opt_;
+    SparseEngine engine_;
+    PopulationPeriod settle_;
+    Census census_;
+    Tally tally_;
+};
+
+} // namespace
+
+int search(Args& args)
+{
+    SearchOptions opt;
+    opt.rule = Rule::parse(args.get("rule", "B3/S23"));
+    opt.soups = args.get_u64("soups", 10000);
+    opt.side = args.get_u64("soup-size", 16);
+    opt.seed = args.get_u64("seed", 1);
+    opt.max_gens = args.get_u64("max-gens", 20000);
+    opt.max_period = static_cast<std::size_t>(args.get_u64("max-period", 60));
+    opt.window = static_cast<std::size_t>(args.get_u64("window", 2 * opt.max_period));
+    const std::uint64_t threads_arg = args.get_u64("threads", 0);
+    opt.census = !args.flag("no-census");
+    const std::uint64_t top = args.get_u64("top", 20);
+    const std::string out_path = args.get("out", "");
+    args.finish();
+    if (opt.side == 0 || opt.side > 64)
+        throw std::runtime_error("--soup-size must be between 1 and 64");
+    // Soups run on the sparse engine; its own checks would only fire on a
+    // pool thread, where an exception ends the process.
+    if (opt.rule.next_state(0))
+        throw std::runtime_error("search cannot run B0 rules: soups need an unbounded plane");
+    if (opt.rule.generations())
+        throw std::runtime_error("search cannot run Generations rules");
+    const std::size_t threads = threads_arg
+        ? static_cast<std::size_t>(threads_arg)
+        : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::unique_ptr<SearchWorker>> workers(threads);
+    ThreadPool pool(threads);
+    std::atomic<std::uint64_t> next{0};
+
+    const auto start = std::chrono::steady_clock::now();
+    pool.run([&](std::size_t i) {
+        // Built on the thread that uses it, so its memory is local to it.
+        workers[i] = std::make_unique<SearchWorker>(opt);
+        for (;;) {
+            const std::uint64_t first = next.fetch_add(kClaimSoups, std::memory_order_relaxed);
+            if (first >= opt.soups)
+                return;
+            const std::uint64_t last = std::min(opt.soups, first + kClaimSoups);
+            for (std::uint64_t s = first; s < last; ++s)
+                workers[i]->run_soup(s);
+        }
+    });
+    const double secs = seconds_since(start);
+
+    Tally total;
+    Census census(opt.rule, opt.max_period);
+    for (const auto& w : workers) {
+        total += w->tally();
+        census.merge(w->census());
+    }
+    const std::uint64_t settled = total.soups - total.unsettled;
+
+    std::printf("rule:        %s\n", opt.rule.to_string().c_str());
+    std::printf("soups:       %llu of %llux%llu from seed %llu\n",
+                static_cast<unsigned long long>(total.soups), static_cast<unsigned long long>(opt.side),
+                static_cast<unsigned long long>(opt.side), static_cast<unsigned long long>(opt.seed));
+    std::printf("threads:     %zu\n", threads);
+    std::printf("settled:     %llu (population periodic for %zu generations, period <= %zu)\n",
+                static_cast<unsigned long long>(settled), opt.window, opt.max_period);
+    std::printf("unsettled:   %llu after %llu generations\n", static_cast<unsigned long long>(total.unsettled),
+                static_cast<unsigned long long>(opt.max_gens));
+    if (total.soups) {
+        std::printf("mean gens:   %.1f\n",
+                    static_cast<double>(total.generations) / static_cast<double>(total.soups));
+        std::printf("mean final:  %.1f cells\n",
+                    static_cast<double>(total.final_population) / static_cast<double>(total.soups));
+    }
+    for (std::size_t p = 1; p < total.periods.size(); ++p)
+        if (total.periods[p])
+            std::printf("  period %-3zu %llu soups\n", p, static_cast<unsigned long long>(total.periods[p]));
+    std::printf("elapsed:     %.3f s\n", secs);
+    if (secs > 0) {
+        std::printf("soups/s:     %.1f\n", static_cast<double>(total.soups) / secs);
+        std::printf("gen/s:       %.3e\n", static_cast<double>(total.generations) / secs);
+    }
+    if (!opt.census)
+        return 0;
+
+    // Most common first, then by name, so the listing is reproducible.
+    std::vector<std::pair<std::string, std::uint64_t>> objects(census.counts().begin(), census.counts().end());
+    std::sort(objects.begin(), objects.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    std::printf("census:      %llu objects, %zu kinds, %llu classified by running them\n",
+                static_cast<unsigned long long>(census.objects()), objects.size(),
+                static_cast<unsigned long long>(census.classified()));
+    std::printf("census time: %.3f s, %.1f%% of soup time\n", total.census_seconds,
+                total.soup_seconds > 0 ? 100.0 * total.census_seconds / total.soup_seconds : 0.0);
+    for (std::size_t i = 0; i < objects.size() && i < top; ++i)
+        std::printf("  %-24s %llu\n", objects[i].first.c_str(),
+                    static_cast<unsigned long long>(objects[i].second));
+    if (!out_path.empty()) {
+        BufferedWriter out(out_path);
+        out.write("# bash-conway census\t");
+        out.write(opt.rule.to_string());
+        out.put('\t');
+        out.write_uint(total.soups);
+        out.write(" soups\n");
+        for (const auto& [name, count] : objects) {
+            out.write(name);
+            out.put('\t');
+            out.write_uint(count);
+            out.put('\n');
+        }
+        out.close();
+        std::printf("written:     %s\n", out_path.c_str());
+    }
+    return 0;
+}
+
+} // namespace conway::cli
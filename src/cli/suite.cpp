@@ -0,0 +1,259 @@
+#include "cli/commands.hpp"
+#include "cli/corpus.hpp"
+
+#include "conway/hashlife.hpp"
+#include "conway/packed_engine.hpp"
+#include "conway/sparse_engine.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace conway::cli {
+
+namespace {
+
+struct SuiteOptions {
+    std::vector<std::string> patterns;
+    std::vector<std::string> engines;
+    std::vector<std::uint64_t> sizes;
+    std::uint64_t gens;
+    unsigned reps;
+    std::uint64_t seed;
+    std::string kernel;
+    std::size_t hash_mem;
+};
+
+/// One pattern x engine x size cell of the suite.
+struct SuiteResult {
+    std::string pattern;
+    std::string engine;
+    std::uint64_t size;
+    /// Wall time of each repetition, sorted ascending.
+    std::vector<double> seconds;
+    std::uint64_t population;
+};
+
+/// One pattern x size x save format: the packed board after the suite's
+/// generations, saved and loaded back.
+struct SaveResult {
+    std::string pattern;
+    SaveFormat format;
+    std::uint64_t size;
+    std::uint64_t bytes;
+    /// Sorted ascending, like SuiteResult::seconds.
+    std::vector<double> save_seconds;
+    std::vector<double> load_seconds;
+};
+
+std::vector<std::string> split_list(const std::string& text)
+{
+    std::vector<std::string> out;
+    std::size_t pos = 0;
+    while (pos <= text.size()) {
+        std::size_t comma = text.find(',', pos);
+        if (comma == std::string::npos)
+            comma = text.size();
+        if (comma > pos)
+            out.push_back(text.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    return out;
+}
+
+/// Nearest-rank percentile of sorted `v`, 0 < p <= 100.
+double percentile(const std::vector<double>& v, double p)
+{
+    std::size_t rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(v.size()) + 0.999999);
+    rank = std::clamp<std::size_t>(rank, 1, v.size());
+    return v[rank - 1];
+}
+
+/// Builds the engine, loads the pattern (untimed), then times `gens`
+/// generations; returns seconds and sets the final population.
+double time_case(const SuiteOptions& opt, const std::string& pattern, const std::string& engine,
+                 std::uint64_t size, std::uint64_t& population)
+{
+    if (engine == "packed" || engine == "packed-mt") {
+        PackedEngine life(size, size, Rule::life(), opt.kernel);
+        GridSink sink(life.current(), 0, 0);
+        emit_corpus(pattern, size, size, opt.seed, sink);
+        if (engine == "packed-mt") {
+            life.set_threads(std::max(1u, std::thread::hardware_concurrency()));
+            life.set_schedule(PackedEngine::Schedule::steal);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        life.run(opt.gens);
+        const double secs = seconds_since(start);
+        population = life.population();
+        return secs;
+    }
+    if (engine == "sparse") {
+        SparseEngine life;
+        SparseSink sink(life, 0, 0);
+        emit_corpus(pattern, size, size, opt.seed, sink);
+        const auto start = std::chrono::steady_clock::now();
+        life.run(opt.gens);
+        const double secs = seconds_since(start);
+        population = life.population();
+        return secs;
+    }
+    if (engine == "hashlife") {
+        HashLife life(Rule::life(), opt.hash_mem);
+        HashLifeSink sink(life, 0, 0);
+        emit_corpus(pattern, size, size, opt.seed, sink);
+        const auto start = std::chrono::steady_clock::now();
+        life.run(opt.gens);
+        const double secs = seconds_since(start);
+        population = life.population();
+        return secs;
+    }
+    throw std::runtime_error("unknown engine '" + engine + "'");
+}
+
+/// Steps `pattern` on a packed board (untimed) and times `opt.reps` round
+/// trips through each save format.
+std::vector<SaveResult> time_saves(const SuiteOptions& opt, const std::string& pattern, std::uint64_t size)
+{
+    PackedEngine life(size, size, Rule::life(), opt.kernel);
+    GridSink sink(life.current(), 0, 0);
+    emit_corpus(pattern, size, size, opt.seed, sink);
+    life.run(opt.gens);
+    std::vector<SaveResult> out;
+    for (const SaveFormat format : {SaveFormat::rle, SaveFormat::snapshot, SaveFormat::compressed}) {
+        SaveResult r{pattern, format, size, 0, {}, {}};
+        for (unsigned i = 0; i < opt.reps; ++i) {
+            const RoundTrip t = time_round_trip(life, format);
+            r.save_seconds.push_back(t.save_seconds);
+            r.load_seconds.push_back(t.load_seconds);
+            r.bytes = t.bytes;
+        }
+        std::sort(r.save_seconds.begin(), r.save_seconds.end());
+        std::sort(r.load_seconds.begin(), r.load_seconds.end());
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+/// Megabytes of board (one bit per cell) on a size x size board.
+double board_mb(std::uint64_t size)
+{
+    return static_cast<double>(size) * static_cast<double>(size) / 8e6;
+}
+
+void write_results(const std::string& path, const SuiteOptions& opt, const std::vector<SuiteResult>& results,
+                   const std::vector<SaveResult>& saves)
+{
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f)
+        throw std::runtime_error("cannot write " + path);
+    const RowKernel k = select_kernel(opt.kernel, Rule::life());
+    std::fprintf(f, "# bash-conway bench suite 2\n");
+    std::fprintf(f, "# kernel %s threads %u gens %llu reps %u seed %llu\n", k.name,
+                 std::max(1u, std::thread::hardware_concurrency()),
+                 static_cast<unsigned long long>(opt.gens), opt.reps,
+                 static_cast<unsigned long long>(opt.seed));
+    std::fprintf(f, "pattern\tengine\tsize\tgens\treps\tgen_s_median\tgen_s_p99\tcell_upd_s_median\t"
+                    "cell_upd_s_p99\tpopulation\n");
+    for (const SuiteResult& r : results) {
+        const double gens = static_cast<double>(opt.gens);
+        const double cells = static_cast<double>(r.size) * static_cast<double>(r.size);
+        const double median = gens / percentile(r.seconds, 50);
+        const double p99 = gens / percentile(r.seconds, 99);
+        std::fprintf(f, "%s\t%s\t%llu\t%llu\t%zu\t%.6g\t%.6g\t%.6g\t%.6g\t%llu\n", r.pattern.c_str(),
+                     r.engine.c_str(), static_cast<unsigned long long>(r.size),
+                     static_cast<unsigned long long>(opt.gens), r.seconds.size(), median, p99,
+                     median * cells, p99 * cells, static_cast<unsigned long long>(r.population));
+    }
+    if (!saves.empty()) {
+        std::fprintf(f, "\n# save and load of each packed board after gens generations, MB/s of board\n");
+        std::fprintf(f, "pattern\tformat\tsize\tbytes\treps\tsave_mb_s_median\tsave_mb_s_p99\t"
+                        "load_mb_s_median\tload_mb_s_p99\n");
+    }
+    for (const SaveResult& r : saves) {
+        const double mb = board_mb(r.size);
+        std::fprintf(f, "%s\t%s\t%llu\t%llu\t%zu\t%.6g\t%.6g\t%.6g\t%.6g\n", r.pattern.c_str(),
+                     format_name(r.format), static_cast<unsigned long long>(r.size),
+                     static_cast<unsigned long long>(r.bytes), r.save_seconds.size(),
+                     mb / percentile(r.save_seconds, 50), mb / percentile(r.save_seconds, 99),
+                     mb / percentile(r.load_seconds, 50), mb / percentile(r.load_seconds, 99));
+    }
+    if (std::fclose(f) != 0)
+        throw std::runtime_error("cannot write " + path);
+}
+
+} // namespace
+
+int bench_suite(Args& args)
+{
+    SuiteOptions opt;
+    const std::string patterns = args.get("patterns", "");
+    opt.engines = split_list(args.get("engines", "packed,packed-mt,sparse,hashlife"));
+    const std::string sizes = args.get("sizes", "512,2048");
+    opt.gens = args.get_u64("gens", 200);
+    const std::uint64_t reps = args.get_u64("reps", 9);
+    opt.seed = args.get_u64("seed", 1);
+    opt.kernel = args.get("kernel", "auto");
+    opt.hash_mem = static_cast<std::size_t>(args.get_u64("hash-mem", 1024)) << 20;
+    const std::string out_path = args.get("out", "bench_output.txt");
+    const bool saves = !args.flag("no-saves");
+    args.finish();
+    if (reps == 0 || opt.gens == 0)
+        throw std::runtime_error("--gens and --reps must be positive");
+    opt.reps = static_cast<unsigned>(reps);
+    if (patterns.empty())
+        opt.patterns.assign(corpus_names().begin(), corpus_names().end());
+    else
+        opt.patterns = split_list(patterns);
+    for (const std::string& s : split_list(sizes))
+        opt.sizes.push_back(std::stoull(s));
+
+    std::printf("bench suite: %llu generations, %u repetitions, median and p99 of each\n",
+                static_cast<unsigned long long>(opt.gens), opt.reps);
+    std::printf("%-12s %-10s %6s %12s %12s %14s %12s\n", "pattern", "engine", "size", "gen/s med",
+                "gen/s p99", "cell-upd/s med", "population");
+    std::vector<SuiteResult> results;
+    for (const std::string& pattern : opt.patterns)
+        for (std::uint64_t size : opt.sizes)
+            for (const std::string& engine : opt.engines) {
+                SuiteResult r{pattern, engine, size, {}, 0};
+                for (unsigned i = 0; i < opt.reps; ++i)
+                    r.seconds.push_back(time_case(opt, pattern, engine, size, r.population));
+                std::sort(r.seconds.begin(), r.seconds.end());
+                const double median = static_cast<double>(opt.gens) / percentile(r.seconds, 50);
+                std::printf("%-12s %-10s %6llu %12.1f %12.1f %14.3e %12llu\n", pattern.c_str(),
+                            engine.c_str(), static_cast<unsigned long long>(size), median,
+                            static_cast<double>(opt.gens) / percentile(r.seconds, 99),
+                            median * static_cast<double>(size) * static_cast<double>(size),
+                            static_cast<unsigned long long>(r.population));
+                std::fflush(stdout);
+                results.push_back(std::move(r));
+            }
+
+    std::vector<SaveResult> save_results;
+    if (saves) {
+        std::printf("\nsave and load after %llu generations on the packed board, MB/s of board\n",
+                    static_cast<unsigned long long>(opt.gens));
+        std::printf("%-12s %-16s %6s %10s %12s %12s\n", "pattern", "format", "size", "file MB", "save med",
+                    "load med");
+        for (const std::string& pattern : opt.patterns)
+            for (std::uint64_t size : opt.sizes)
+                for (SaveResult& r : time_saves(opt, pattern, size)) {
+                    const double mb = board_mb(size);
+                    std::printf("%-12s %-16s %6llu %10.2f %12.1f %12.1f\n", pattern.c_str(),
+                                format_name(r.format), static_cast<unsigned long long>(size),
+                                static_cast<double>(r.bytes) / 1e6, mb / percentile(r.save_seconds, 50),
+                                mb / percentile(r.load_seconds, 50));
+                    std::fflush(stdout);
+                    save_results.push_back(std::move(r));
+                }
+    }
+    write_results(out_path, opt, results, save_results);
+    std::printf("results written to %s\n", out_path.c_str());
+    return 0;
+}
+
+} // namespace conway::cli
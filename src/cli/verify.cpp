@@ -0,0 +1,472 @@
+#include "cli/commands.hpp"
+#include "cli/corpus.hpp"
+
+#include "conway/generations_engine.hpp"
+#include "conway/hashlife.hpp"
+#include "conway/ltl_engine.hpp"
+#include "conway/packed_engine.hpp"
+#include "conway/reference.hpp"
+#include "conway/sparse_engine.hpp"
+
+#include <bit>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace conway::cli {
+
+namespace {
+
+/// Population (state 1) and board hash at one generation.
+struct Checkpoint {
+    std::uint64_t generation;
+    std::uint64_t population;
+    std::uint64_t hash;
+    /// Half-open bounding box, for implementations that maintain one.
+    bool has_bounds = false;
+    std::int64_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    /// For engines with a running board hash: whether it still matches a
+    /// scan of their own board.
+    bool hash_current = true;
+    /// For engines that allocate and free tiles: how many are held, which
+    /// must be none once the board is empty.
+    std::size_t tiles = 0;
+};
+
+template <class Engine>
+void add_bounds(const Engine& engine, Checkpoint& c)
+{
+    c.has_bounds = true;
+    if (!engine.bounds(c.x0, c.y0, c.x1, c.y1))
+        c.x0 = c.y0 = c.x1 = c.y1 = 0;
+}
+
+/// One stepping implementation under test, built fresh for every start.
+class Candidate {
+public:
+    virtual ~Candidate() = default;
+    virtual CellSink& sink() = 0;
+    virtual void run(std::uint64_t generations) = 0;
+    virtual Checkpoint sample() const = 0;
+};
+
+Checkpoint sample_grid(const Grid& grid, std::uint64_t generation)
+{
+    Checkpoint c{generation, grid.population(), 0};
+    for (std::size_t y = 0; y < grid.height(); ++y)
+        for (std::size_t i = 0; i < grid.words_per_row(); ++i)
+            for (std::uint64_t w = grid.row(y)[i]; w; w &= w - 1)
+                c.hash += cell_hash(static_cast<std::int64_t>(i * 64) + std::countr_zero(w),
+                                    static_cast<std::int64_t>(y));
+    return c;
+}
+
+/// Scans a byte-per-cell style engine through its state() accessor.
+template <class Engine>
+Checkpoint sample_states(const Engine& engine)
+{
+    Checkpoint c{engine.generation(), engine.population(), 0};
+    for (std::size_t y = 0; y < engine.height(); ++y)
+        for (std::size_t x = 0; x < engine.width(); ++x)
+            if (const unsigned s = engine.state(x, y))
+                c.hash += cell_hash(static_cast<std::int64_t>(x), static_cast<std::int64_t>(y), s);
+    return c;
+}
+
+/// Scans an unbounded engine through for_each_live().
+template <class Engine>
+Checkpoint sample_live(const Engine& engine)
+{
+    HashSink hash;
+    engine.for_each_live(hash);
+    Checkpoint c{engine.generation(), hash.population(), hash.hash()};
+    add_bounds(engine, c);
+    return c;
+}
+
+class PackedCandidate : public Candidate {
+public:
+    PackedCandidate(std::size_t size, const Rule& rule, const RowKernel& kernel, bool skip,
+                    std::size_t threads, PackedEngine::Schedule schedule)
+        : engine_(size, size, rule), sink_(engine_.current(), 0, 0)
+    {
+        engine_.set_kernel(kernel);
+        engine_.set_tile_skipping(skip);
+        engine_.set_threads(threads);
+        engine_.set_schedule(schedule);
+    }
+    CellSink& sink() override
+    {
+        engine_.invalidate();
+        return sink_;
+    }
+    void run(std::uint64_t generations) override { engine_.run(generations); }
+    Checkpoint sample() const override
+    {
+        // The engine's own running population and box, checked against the
+        // scan of the board below.
+        Checkpoint c = sample_grid(engine_.current(), engine_.generation());
+        c.population = engine_.population();
+        add_bounds(engine_, c);
+        const Grid& grid = engine_.current();
+        std::uint64_t words = 0;
+        for (std::size_t y = 0; y < grid.height(); ++y)
+            for (std::size_t i = 0; i < grid.words_per_row(); ++i)
+                words += word_hash(y * grid.words_per_row() + i, grid.row(y)[i]);
+        c.hash_current = words == engine_.hash();
+        return c;
+    }
+
+private:
+    PackedEngine engine_;
+    GridSink sink_;
+};
+
+class SparseCandidate : public Candidate {
+public:
+    explicit SparseCandidate(const Rule& rule) : engine_(rule), sink_(engine_, 0, 0) {}
+    CellSink& sink() override { return sink_; }
+    void run(std::uint64_t generations) override { engine_.run(generations); }
+    Checkpoint sample() const override
+    {
+        Checkpoint c = sample_live(engine_);
+        c.tiles = engine_.tile_count();
+        return c;
+    }
+
+private:
+    SparseEngine engine_;
+    SparseSink sink_;
+};
+
+class HashLifeCandidate : public Candidate {
+public:
+    explicit HashLifeCandidate(const Rule& rule) : life_(rule), sink_(life_, 0, 0) {}
+    CellSink& sink() override { return sink_; }
+    void run(std::uint64_t generations) override { life_.run(generations); }
+    Checkpoint sample() const override { return sample_live(life_); }
+
+private:
+    HashLife life_;
+    HashLifeSink sink_;
+};
+
+class GenerationsCandidate : public Candidate {
+public:
+    GenerationsCandidate(std::size_t size, const Rule& rule, std::string_view isa)
+        : engine_(size, size, rule, isa), sink_(engine_, 0, 0) {}
+    CellSink& sink() override { return sink_; }
+    void run(std::uint64_t generations) override { engine_.run(generations); }
+    Checkpoint sample() const override { return sample_states(engine_); }
+
+private:
+    GenerationsEngine engine_;
+    GenerationsSink sink_;
+};
+
+class LtlCandidate : public Candidate {
+public:
+    LtlCandidate(std::size_t size, const LtlRule& rule) : engine_(size, size, rule), sink_(engine_, 0, 0) {}
+    CellSink& sink() override { return sink_; }
+    void run(std::uint64_t generations) override { engine_.run(generations); }
+    Checkpoint sample() const override { return sample_states(engine_); }
+
+private:
+    LtlEngine engine_;
+    LtlSink sink_;
+};
+
+using AnyRule = std::variant<Rule, LtlRule>;
+
+struct Implementation {
+    std::string name;
+    /// Runs on an unbounded plane, so it can only match the torus reference
+    /// until the pattern reaches the board edge.
+    bool unbounded;
+    std::function<std::unique_ptr<Candidate>()> make;
+    /// The rule is one it cannot run: make() must throw rather than build
+    /// an engine that gives wrong answers.
+    bool rejects = false;
+};
+
+/// Every stepping implementation that can run `rule` on a size x size board,
+/// plus the unbounded ones marked `rejects` when it is a B0 rule.
+std::vector<Implementation> implementations(const AnyRule& any, std::size_t size)
+{
+    std::vector<Implementation> out;
+    if (const LtlRule* ltl = std::get_if<LtlRule>(&any)) {
+        out.push_back({"ltl", false, [=] { return std::make_unique<LtlCandidate>(size, *ltl); }});
+        return out;
+    }
+    const Rule rule = std::get<Rule>(any);
+    if (rule.generations()) {
+        for (std::string_view isa : available_isas())
+            out.push_back({"generations " + std::string(isa), false,
+                           [=] { return std::make_unique<GenerationsCandidate>(size, rule, isa); }});
+        return out;
+    }
+    using Schedule = PackedEngine::Schedule;
+    for (std::string_view isa : available_isas())
+        for (const RowKernel& k : kernels_for(isa, rule))
+            out.push_back({std::string("packed ") + k.name + "/" + k.variant, false, [=] {
+                               return std::make_unique<PackedCandidate>(size, rule, k, true, 1, Schedule::bands);
+                           }});
+    const RowKernel k = select_kernel("auto", rule);
+    out.push_back({"packed no-skip", false, [=] {
+                       return std::make_unique<PackedCandidate>(size, rule, k, false, 1, Schedule::bands);
+                   }});
+    out.push_back({"packed 3 threads bands", false, [=] {
+                       return std::make_unique<PackedCandidate>(size, rule, k, true, 3, Schedule::bands);
+                   }});
+    out.push_back({"packed 3 threads steal", false, [=] {
+                       return std::make_unique<PackedCandidate>(size, rule, k, true, 3, Schedule::steal);
+                   }});
+    // B0 rules fill empty space, which an unbounded plane cannot hold.
+    const bool b0 = rule.next_state(0);
+    out.push_back({"sparse", true, [=] { return std::make_unique<SparseCandidate>(rule); }, b0});
+    out.push_back({"hashlife", true, [=] { return std::make_unique<HashLifeCandidate>(rule); }, b0});
+    return out;
+}
+
+struct VerifyOptions {
+    std::size_t size;
+    std::uint64_t gens;
+    std::uint64_t every;
+    std::uint64_t soups;
+    std::uint64_t seed;
+};
+
+struct Start {
+    std::string name;
+    /// Stamps the start into a sink laid out as a size x size board.
+    std::function<void(CellSink&)> emit;
+};
+
+/// Random soups in a centred patch for every rule, plus the corpus patterns
+/// for Life itself.
+std::vector<Start> starts_for(const AnyRule& any, const VerifyOptions& opt)
+{
+    std::vector<Start> out;
+    const std::size_t patch = std::min<std::size_t>(48, opt.size);
+    const auto offset = static_cast<std::int64_t>((opt.size - patch) / 2);
+    const unsigned states = std::visit([](const auto& r) { return unsigned{r.states}; }, any);
+    for (std::uint64_t i = 0; i < opt.soups; ++i) {
+        const std::uint64_t seed = opt.seed + i;
+        out.push_back({"soup-" + std::to_string(seed), [=](CellSink& sink) {
+                           OffsetSink centred(sink, offset, offset);
+                           emit_soup(patch, patch, 0.5, seed, centred);
+                           // Generations soups also start with some decaying
+                           // cells, from a second soup over the dead ones.
+                           if (states > 2) {
+                               Grid decay(patch, patch);
+                               decay.randomize(0.25, ~seed);
+                               for (std::size_t y = 0; y < patch; ++y)
+                                   for (std::size_t x = 0; x < patch; ++x)
+                                       if (decay.get(x, y))
+                                           centred.state_run(static_cast<std::int64_t>(x),
+                                                             static_cast<std::int64_t>(y), 1,
+                                                             2 + static_cast<unsigned>((x + y) % (states - 2)));
+                           }
+                       }});
+    }
+    const Rule* rule = std::get_if<Rule>(&any);
+    if (rule && rule->is_life()) {
+        for (std::string_view name : corpus_names())
+            if (name != "soup")
+                out.push_back({std::string(name), [=, size = opt.size](CellSink& sink) {
+                                   emit_corpus(name, size, size, opt.seed, sink);
+                               }});
+        // Diagonal triples, inside tiles and across their edges, leave one
+        // cell for a generation and then nothing: engines that free tiles
+        // must end up holding none.
+        out.push_back({"die-out", [size = opt.size](CellSink& sink) {
+                           for (std::size_t y = 32; y + 32 <= size; y += 32)
+                               for (std::size_t x = 32; x + 32 <= size; x += 32)
+                                   for (std::int64_t d = -1; d <= 1; ++d)
+                                       sink.live_run(static_cast<std::int64_t>(x) + d,
+                                                     static_cast<std::int64_t>(y) + d, 1);
+                       }});
+    }
+    return out;
+}
+
+struct Tally {
+    std::size_t passed = 0;
+    std::size_t failed = 0;
+    std::size_t skipped = 0;
+};
+
+void verify_rule(const AnyRule& any, const VerifyOptions& opt, std::FILE* out, Tally& tally)
+{
+    const std::string rule_name = std::visit([](const auto& r) { return r.to_string(); }, any);
+    // A cell this close to the edge may already have wrapped round the torus.
+    const std::size_t margin = std::holds_alternative<LtlRule>(any) ? std::get<LtlRule>(any).range + 1 : 2;
+    std::vector<Implementation> impls = implementations(any, opt.size);
+
+    // Engines that must refuse the rule are checked once, then left out.
+    for (const Implementation& impl : impls) {
+        if (!impl.rejects)
+            continue;
+        std::string accepted;
+        try {
+            impl.make();
+            accepted = "accepted a rule it cannot run";
+        } catch (const std::runtime_error&) {
+        }
+        if (accepted.empty()) {
+            ++tally.passed;
+            std::fprintf(out, "PASS  %-22s %-12s %-26s rejects the rule\n", rule_name.c_str(), "-",
+                         impl.name.c_str());
+        } else {
+            ++tally.failed;
+            std::fprintf(out, "FAIL  %-22s %-12s %-26s %s\n", rule_name.c_str(), "-", impl.name.c_str(),
+                         accepted.c_str());
+            std::printf("FAIL  %s %s: %s\n", rule_name.c_str(), impl.name.c_str(), accepted.c_str());
+        }
+    }
+    std::erase_if(impls, [](const Implementation& impl) { return impl.rejects; });
+
+    for (const Start& start : starts_for(any, opt)) {
+        // The reference trajectory, and the last checkpoint before the
+        // pattern first came near the edge.
+        ReferenceEngine reference = std::visit(
+            [&](const auto& r) { return ReferenceEngine(opt.size, opt.size, r); }, any);
+        ReferenceSink ref_sink(reference, 0, 0);
+        start.emit(ref_sink);
+        std::vector<Checkpoint> expected;
+        std::size_t bounded = SIZE_MAX;
+        bool edge = reference.near_edge(margin);
+        if (edge)
+            bounded = 0;
+        while (reference.generation() < opt.gens) {
+            for (std::uint64_t g = 0; g < opt.every; ++g) {
+                reference.step();
+                if (!edge && reference.near_edge(margin)) {
+                    edge = true;
+                    bounded = expected.size();
+                }
+            }
+            Checkpoint c{reference.generation(), reference.population(), reference.hash()};
+            add_bounds(reference, c);
+            expected.push_back(c);
+        }
+
+        for (const Implementation& impl : impls) {
+            const std::size_t limit = impl.unbounded ? std::min(bounded, expected.size()) : expected.size();
+            if (limit == 0) {
+                ++tally.skipped;
+                std::fprintf(out, "SKIP  %-22s %-12s %-26s pattern reaches the edge at once\n",
+                             rule_name.c_str(), start.name.c_str(), impl.name.c_str());
+                continue;
+            }
+            std::unique_ptr<Candidate> candidate = impl.make();
+            start.emit(candidate->sink());
+            std::string failure;
+            for (std::size_t i = 0; i < limit && failure.empty(); ++i) {
+                candidate->run(opt.every);
+                const Checkpoint got = candidate->sample();
+                const Checkpoint& want = expected[i];
+                if (!got.hash_current)
+                    failure = "gen " + std::to_string(want.generation) + ": running board hash drifted";
+                if (got.population == 0 && got.tiles)
+                    failure = "gen " + std::to_string(want.generation) + ": empty board still holds " +
+                              std::to_string(got.tiles) + " tiles";
+                if (got.has_bounds && (got.x0 != want.x0 || got.y0 != want.y0 || got.x1 != want.x1
+                                       || got.y1 != want.y1)) {
+                    char line[256];
+                    std::snprintf(line, sizeof line,
+                                  "gen %llu: bounds [%lld,%lld)x[%lld,%lld) (reference [%lld,%lld)x[%lld,%lld))",
+                                  static_cast<unsigned long long>(want.generation),
+                                  static_cast<long long>(got.x0), static_cast<long long>(got.x1),
+                                  static_cast<long long>(got.y0), static_cast<long long>(got.y1),
+                                  static_cast<long long>(want.x0), static_cast<long long>(want.x1),
+                                  static_cast<long long>(want.y0), static_cast<long long>(want.y1));
+                    failure = line;
+                }
+                if (got.population != want.population || got.hash != want.hash) {
+                    char line[256];
+                    std::snprintf(line, sizeof line,
+                                  "gen %llu: population %llu (reference %llu), hash %016llx (reference %016llx)",
+                                  static_cast<unsigned long long>(want.generation),
+                                  static_cast<unsigned long long>(got.population),
+                                  static_cast<unsigned long long>(want.population),
+                                  static_cast<unsigned long long>(got.hash),
+                                  static_cast<unsigned long long>(want.hash));
+                    failure = line;
+                }
+            }
+            if (!failure.empty()) {
+                ++tally.failed;
+                std::fprintf(out, "FAIL  %-22s %-12s %-26s %s\n", rule_name.c_str(), start.name.c_str(),
+                             impl.name.c_str(), failure.c_str());
+                std::printf("FAIL  %s %s %s: %s\n", rule_name.c_str(), start.name.c_str(), impl.name.c_str(),
+                            failure.c_str());
+                continue;
+            }
+            ++tally.passed;
+            std::fprintf(out, "PASS  %-22s %-12s %-26s %zu checkpoints", rule_name.c_str(),
+                         start.name.c_str(), impl.name.c_str(), limit);
+            if (limit < expected.size())
+                std::fprintf(out, " (of %zu; pattern reached the edge)", expected.size());
+            std::fputc('\n', out);
+        }
+    }
+}
+
+} // namespace
+
+int verify(Args& args)
+{
+    VerifyOptions opt;
+    opt.size = static_cast<std::size_t>(args.get_u64("size", 256));
+    opt.gens = args.get_u64("gens", 128);
+    opt.every = args.get_u64("every", 16);
+    opt.soups = args.get_u64("soups", 3);
+    opt.seed = args.get_u64("seed", 1);
+    const std::string rule_text = args.get("rule", "");
+    const std::string out_path = args.get("out", "test_output.txt");
+    args.finish();
+    if (opt.every == 0 || opt.gens == 0)
+        throw std::runtime_error("--gens and --every must be positive");
+    if (opt.size % 64 != 0)
+        throw std::runtime_error("--size must be a multiple of 64");
+
+    std::vector<AnyRule> rules;
+    if (!rule_text.empty()) {
+        if (LtlRule::is_ltl(rule_text))
+            rules.push_back(LtlRule::parse(rule_text));
+        else
+            rules.push_back(Rule::parse(rule_text));
+    } else {
+        for (const char* text : {"B3/S23", "B36/S23", "B3678/S34678", "B36/S245", "B03/S23", "B2-a/S12",
+                                 "B3/S2-i34q", "B3-cnqy/S234", "/2/3", "345/2/4"})
+            rules.push_back(Rule::parse(text));
+        for (const char* text : {"R5,C0,M1,S34..58,B34..45,NM", "R3,C0,M1,S6..12,B5..9,NN",
+                                 "R2,C4,M0,S5..10,B6..8,NM"})
+            rules.push_back(LtlRule::parse(text));
+    }
+
+    std::FILE* out = std::fopen(out_path.c_str(), "w");
+    if (!out)
+        throw std::runtime_error("cannot write " + out_path);
+    std::fprintf(out, "# bash-conway verify: %zux%zu torus, %llu generations, checkpoint every %llu\n",
+                 opt.size, opt.size, static_cast<unsigned long long>(opt.gens),
+                 static_cast<unsigned long long>(opt.every));
+    Tally tally;
+    for (const AnyRule& rule : rules) {
+        verify_rule(rule, opt, out, tally);
+        std::fflush(out);
+    }
+    std::fprintf(out, "# passed %zu, failed %zu, skipped %zu\n", tally.passed, tally.failed, tally.skipped);
+    if (std::fclose(out) != 0)
+        throw std::runtime_error("cannot write " + out_path);
+    std::printf("verify: passed %zu, failed %zu, skipped %zu (details in %s)\n", tally.passed, tally.failed,
+                tally.skipped, out_path.c_str());
+    return tally.failed == 0 ? 0 : 1;
+}
+
+} // namespace conway::cli
@@ -0,0 +1,118 @@
+#include "conway/density_pyramid.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace conway {
+
+void DensityPyramid::rebuild(const PackedEngine& engine)
+{
+    levels_.clear();
+    Level base;
+    base.width = engine.tiles_x();
+    base.height = engine.tiles_y();
+    base.counts.resize(base.width * base.height);
+    for (std::size_t ty = 0; ty < base.height; ++ty)
+        for (std::size_t tx = 0; tx < base.width; ++tx)
+            base.counts[ty * base.width + tx] = engine.tile_population(tx, ty);
+    levels_.push_back(std::move(base));
+    while (levels_.back().width > 1 || levels_.back().height > 1) {
+        const Level& below = levels_.back();
+        Level up;
+        up.width = (below.width + 1) / 2;
+        up.height = (below.height + 1) / 2;
+        up.counts.assign(up.width * up.height, 0);
+        for (std::size_t y = 0; y < below.height; ++y)
+            for (std::size_t x = 0; x < below.width; ++x)
+                up.counts[y / 2 * up.width + x / 2] += below.counts[y * below.width + x];
+        levels_.push_back(std::move(up));
+    }
+    engine_ = &engine;
+    generation_ = engine.generation();
+}
+
+void DensityPyramid::update(const PackedEngine& engine)
+{
+    if (engine_ == &engine && !levels_.empty()) {
+        if (engine.generation() == generation_)
+            return;
+        if (engine.generation() != generation_ + 1) {
+            rebuild(engine);
+            return;
+        }
+    } else {
+        rebuild(engine);
+        return;
+    }
+    Level& base = levels_.front();
+    for (std::size_t ty = 0; ty < base.height; ++ty)
+        for (std::size_t tx = 0; tx < base.width; ++tx) {
+            if (!engine.tile_changed(tx, ty))
+                continue;
+            const std::uint64_t now = engine.tile_population(tx, ty);
+            const std::uint64_t delta = now - base.counts[ty * base.width + tx];
+            if (!delta)
+                continue;
+            // Unsigned wrap-around makes a drop an addition too.
+            for (std::size_t k = 0; k < levels_.size(); ++k) {
+                Level& l = levels_[k];
+                l.counts[(ty >> k) * l.width + (tx >> k)] += delta;
+            }
+        }
+    generation_ = engine.generation();
+}
+
+void DensityPyramid::downsample(const PackedEngine& engine, std::size_t zoom, std::size_t bx0,
+                                std::size_t by0, Grid& out) const
+{
+    if (zoom < PackedEngine::kTileRows) {
+        downsample_board(engine.current(), zoom, bx0, by0, out);
+        return;
+    }
+    const auto k = static_cast<std::size_t>(std::countr_zero(zoom / PackedEngine::kTileRows));
+    const Level& l = levels_[std::min(k, levels_.size() - 1)];
+    // A board narrower than the window is shown once, not tiled.
+    const std::size_t width = std::min(out.width(), l.width);
+    const std::size_t height = std::min(out.height(), l.height);
+    out.clear();
+    for (std::size_t j = 0; j < height; ++j) {
+        const std::uint64_t* counts = &l.counts[(by0 + j) % l.height * l.width];
+        std::uint64_t* row = out.row(j);
+        for (std::size_t i = 0; i < width; ++i)
+            row[i / Grid::kWordBits] |= std::uint64_t{counts[(bx0 + i) % l.width] != 0} << (i % Grid::kWordBits);
+    }
+}
+
+void DensityPyramid::downsample_board(const Grid& board, std::size_t zoom, std::size_t bx0, std::size_t by0,
+                                      Grid& out) const
+{
+    // The board width is a whole number of words, so blocks of up to 64
+    // cells tile it exactly and a gather never splits a block.
+    const std::size_t across = blocks(board.width(), zoom);
+    const std::size_t down = blocks(board.height(), zoom);
+    const std::size_t width = std::min(out.width(), across);
+    const std::size_t height = std::min(out.height(), down);
+    const std::size_t per_word = Grid::kWordBits / zoom;
+    const std::size_t words = (width + per_word - 1) / per_word;
+    std::vector<std::uint64_t> any(words);
+    out.clear();
+    for (std::size_t j = 0; j < height; ++j) {
+        std::fill(any.begin(), any.end(), 0);
+        const std::size_t y0 = (by0 + j) % down * zoom;
+        const std::size_t y1 = std::min(board.height(), y0 + zoom);
+        for (std::size_t y = y0; y < y1; ++y)
+            for (std::size_t c = 0; c < words; ++c)
+                any[c] |= board.gather((bx0 + c * per_word) % across * zoom, y);
+        for (std::size_t c = 0; c < words; ++c) {
+            // Smear each block's cells onto its lowest bit, then pick those.
+            std::uint64_t v = any[c];
+            for (std::size_t s = 1; s < zoom; s <<= 1)
+                v |= v >> s;
+            for (std::size_t b = 0; b < per_word && c * per_word + b < width; ++b)
+                if (v >> (b * zoom) & 1)
+                    out.set(c * per_word + b, j, true);
+        }
+    }
+}
+
+} // namespace conway
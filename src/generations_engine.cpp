@@ -0,0 +1,179 @@
+#include "conway/generations_engine.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace conway {
+
+GenerationsEngine::GenerationsEngine(std::size_t width, std::size_t height, const Rule& rule,
+                                     std::string_view kernel)
+    : rule_(rule)
+    , compiled_(rule)
+    , kernel_(select_kernel(kernel, rule))
+    , alive_(width, height)
+    , next_(width, height)
+    , carry_(alive_.words_per_row())
+    , last_(alive_.words_per_row())
+{
+    // States 2 .. states-1 need counter values 1 .. states-2.
+    const unsigned planes = rule.states > 2 ? std::bit_width(static_cast<unsigned>(rule.states - 2)) : 0;
+    decay_.assign(planes, Grid(width, height));
+}
+
+Grid& GenerationsEngine::alive()
+{
+    return alive_;
+}
+
+unsigned GenerationsEngine::state(std::size_t x, std::size_t y) const
+{
+    if (alive_.get(x, y))
+        return 1;
+    unsigned d = 0;
+    for (std::size_t j = 0; j < decay_.size(); ++j)
+        d |= static_cast<unsigned>(decay_[j].get(x, y)) << j;
+    return d ? d + 1 : 0;
+}
+
+void GenerationsEngine::set_state(std::size_t x, std::size_t y, unsigned state)
+{
+    if (state >= rule_.states)
+        throw std::runtime_error("state out of range for " + rule_.to_string());
+    alive_.set(x, y, state == 1);
+    const unsigned d = state >= 2 ? state - 1 : 0;
+    for (std::size_t j = 0; j < decay_.size(); ++j)
+        decay_[j].set(x, y, (d >> j) & 1u);
+}
+
+void GenerationsEngine::update_decay(std::size_t y, std::uint64_t* next_alive)
+{
+    // Plane-at-a-time loops over the row so each one is a plain streaming
+    // loop the compiler vectorises.
+    const std::size_t words = alive_.words_per_row();
+    const std::uint64_t* a = alive_.row(y);
+    const unsigned final_d = rule_.states - 2u;
+    std::uint64_t* carry = carry_.data();
+    std::uint64_t* last = last_.data();
+
+    // carry = decaying (d != 0), last = (d == states - 2).
+    std::fill(carry, carry + words, 0);
+    std::fill(last, last + words, ~std::uint64_t{0});
+    for (std::size_t j = 0; j < decay_.size(); ++j) {
+        const std::uint64_t* d = decay_[j].row(y);
+        const std::uint64_t want = (final_d >> j) & 1u ? ~std::uint64_t{0} : 0;
+        for (std::size_t i = 0; i < words; ++i) {
+            carry[i] |= d[i];
+            last[i] &= ~(d[i] ^ want);
+        }
+    }
+    // Decaying cells cannot be born, and live cells that fail to survive
+    // (dropped from the live plane by the kernel) start decaying at d = 0,
+    // so one carry both advances the old counters and seeds the new ones.
+    // Counters that reach the last state wrap to dead.
+    for (std::size_t i = 0; i < words; ++i) {
+        const std::uint64_t start = a[i] & ~next_alive[i];
+        next_alive[i] &= ~carry[i];
+        last[i] = ~(last[i] & carry[i]);
+        carry[i] |= start;
+    }
+    for (std::size_t j = 0; j < decay_.size(); ++j) {
+        std::uint64_t* d = decay_[j].row(y);
+        for (std::size_t i = 0; i < words; ++i) {
+            const std::uint64_t bit = d[i] ^ carry[i];
+            carry[i] &= d[i];
+            d[i] = bit & last[i];
+        }
+    }
+}
+
+void GenerationsEngine::step()
+{
+    const std::size_t h = alive_.height();
+    const std::size_t words = alive_.words_per_row();
+    for (std::size_t y = 0; y < h; ++y) {
+        const std::uint64_t* up = alive_.row(y == 0 ? h - 1 : y - 1);
+        const std::uint64_t* down = alive_.row(y + 1 == h ? 0 : y + 1);
+        kernel_.fn(up, alive_.row(y), down, next_.row(y), words, 0, words, compiled_);
+        update_decay(y, next_.row(y));
+    }
+    swap(alive_, next_);
+    ++generation_;
+}
+
+void GenerationsEngine::run(std::uint64_t generations)
+{
+    for (std::uint64_t g = 0; g < generations; ++g)
+        step();
+}
+
+std::uint64_t GenerationsEngine::decaying() const
+{
+    std::uint64_t total = 0;
+    const std::size_t n = alive_.word_count();
+    for (std::size_t i = 0; i < n; ++i) {
+        std::uint64_t any = 0;
+        for (const Grid& d : decay_)
+            any |= d.data()[i];
+        total += static_cast<std::uint64_t>(std::popcount(any));
+    }
+    return total;
+}
+
+void GenerationsEngine::write_rle(BufferedWriter& out) const
+{
+    // Occupancy (any non-dead state) per word, for the bounding box and to
+    // skip empty words while emitting.
+    const std::size_t words = alive_.words_per_row();
+    auto occupied = [&](std::size_t y, std::size_t i) {
+        std::uint64_t w = alive_.row(y)[i];
+        for (const Grid& d : decay_)
+            w |= d.row(y)[i];
+        return w;
+    };
+    std::size_t y0 = height(), y1 = 0, x0 = width(), x1 = 0;
+    for (std::size_t y = 0; y < height(); ++y)
+        for (std::size_t i = 0; i < words; ++i)
+            if (const std::uint64_t w = occupied(y, i)) {
+                y0 = std::min(y0, y);
+                y1 = y + 1;
+                x0 = std::min(x0, i * 64 + static_cast<std::size_t>(std::countr_zero(w)));
+                x1 = std::max(x1, i * 64 + 64 - static_cast<std::size_t>(std::countl_zero(w)));
+            }
+    if (y1 == 0)
+        y0 = x0 = 0;
+
+    RleWriter rle(out, static_cast<std::int64_t>(x1 - x0), static_cast<std::int64_t>(y1 - y0), rule_);
+    for (std::size_t y = y0; y < y1; ++y) {
+        if (y != y0)
+            rle.next_row();
+        for (std::size_t i = 0; i < words; ++i) {
+            std::uint64_t w = occupied(y, i);
+            while (w) {
+                const int b = std::countr_zero(w);
+                w &= w - 1;
+                rle.run(static_cast<std::int64_t>(i * 64 + static_cast<std::size_t>(b) - x0), 1,
+                        state(i * 64 + static_cast<std::size_t>(b), y));
+            }
+        }
+    }
+    rle.finish();
+}
+
+void GenerationsSink::live_run(std::int64_t x, std::int64_t y, std::int64_t length)
+{
+    alive_.live_run(x, y, length);
+}
+
+void GenerationsSink::state_run(std::int64_t x, std::int64_t y, std::int64_t length, unsigned state)
+{
+    const auto w = static_cast<std::int64_t>(engine_.width());
+    const auto h = static_cast<std::int64_t>(engine_.height());
+    const std::int64_t row = ((y + y0_) % h + h) % h;
+    for (std::int64_t i = 0; i < length; ++i) {
+        const std::int64_t col = ((x + i + x0_) % w + w) % w;
+        engine_.set_state(static_cast<std::size_t>(col), static_cast<std::size_t>(row), state);
+    }
+}
+
+} // namespace conway
@@ -0,0 +1,58 @@
+#include "conway/grid.hpp"
+
+#include "conway/random.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace conway {
+
+Grid::Grid(std::size_t width, std::size_t height)
+    : height_(height)
+    , words_per_row_((width + kWordBits - 1) / kWordBits)
+{
+    width_ = words_per_row_ * kWordBits;
+    words_.assign(words_per_row_ * height_, 0);
+}
+
+void Grid::clear()
+{
+    std::fill(words_.begin(), words_.end(), 0);
+}
+
+void Grid::copy_window(const Grid& src, std::size_t x0, std::size_t y0)
+{
+    for (std::size_t y = 0; y < height_; ++y) {
+        const std::size_t sy = (y0 + y) % src.height_;
+        std::uint64_t* out = row(y);
+        for (std::size_t i = 0; i < words_per_row_; ++i)
+            out[i] = src.gather((x0 + i * kWordBits) % src.width_, sy);
+    }
+}
+
+std::uint64_t Grid::population() const
+{
+    std::uint64_t total = 0;
+    for (std::uint64_t w : words_)
+        total += static_cast<std::uint64_t>(std::popcount(w));
+    return total;
+}
+
+void Grid::randomize(double density, std::uint64_t seed)
+{
+    SplitMix64 rng(seed);
+    if (density == 0.5) {
+        for (std::uint64_t& w : words_)
+            w = rng.next();
+        return;
+    }
+    for (std::uint64_t& w : words_) {
+        std::uint64_t bits = 0;
+        for (std::size_t b = 0; b < kWordBits; ++b)
+            if (rng.uniform() < density)
+                bits |= std::uint64_t{1} << b;
+        w = bits;
+    }
+}
+
+} // namespace conway
@@ -0,0 +1,537 @@
+#include "conway/hashlife.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace conway {
+
+namespace {
+
+std::uint64_t hash4(std::uint32_t a, std::uint32_t b, std::uint32_t c, std::uint32_t d)
+{
+    std::uint64_t h = (std::uint64_t{a} << 32 | b) * 0x9e3779b97f4a7c15ull;
+    h ^= (std::uint64_t{c} << 32 | d) * 0xc2b2ae3d27d4eb4full;
+    return h ^ (h >> 29);
+}
+
+} // namespace
+
+HashLife::HashLife(const Rule& rule, std::size_t memory_limit)
+    : rule_(rule)
+    , memory_limit_(memory_limit)
+    , next_gc_bytes_(memory_limit)
+{
+    // An empty node's successor is taken to be empty, which B0 contradicts.
+    if (rule.next_state(0))
+        throw std::runtime_error("B0 rules cannot run on an unbounded plane");
+    if (rule.generations())
+        throw std::runtime_error("Generations rules need the generations engine");
+    for (unsigned bits = 0; bits < 65536; ++bits) {
+        auto cell = [bits](int x, int y) { return (bits >> (y * 4 + x)) & 1u; };
+        std::uint8_t out = 0;
+        int slot = 0;
+        for (int y = 1; y <= 2; ++y)
+            for (int x = 1; x <= 2; ++x, ++slot) {
+                std::uint32_t n = 0;
+                for (int dy = -1; dy <= 1; ++dy)
+                    for (int dx = -1; dx <= 1; ++dx)
+                        n |= cell(x + dx, y + dy) << (3 * (dy + 1) + (dx + 1));
+                if (rule_.next_state(n))
+                    out |= static_cast<std::uint8_t>(1u << slot);
+            }
+        base_table_[bits] = out;
+    }
+
+    nodes_.push_back({kNone, kNone, kNone, kNone, kNone, 0, 0});
+    nodes_.push_back({kNone, kNone, kNone, kNone, kNone, 0, 1});
+    rehash(1024);
+    empty_.push_back(0);
+    root_ = empty(3);
+}
+
+std::size_t HashLife::memory_bytes() const
+{
+    return node_count() * sizeof(Node) + slots_.size() * sizeof(std::uint32_t);
+}
+
+void HashLife::rehash(std::size_t slots)
+{
+    slots_.assign(slots, kNone);
+    used_slots_ = 0;
+    const std::size_t mask = slots - 1;
+    for (std::uint32_t id = 2; id < nodes_.size(); ++id) {
+        const Node& n = nodes_[id];
+        if (n.level == 0)
+            continue; // free-listed
+        std::size_t i = hash4(n.nw, n.ne, n.sw, n.se) & mask;
+        while (slots_[i] != kNone)
+            i = (i + 1) & mask;
+        slots_[i] = id;
+        ++used_slots_;
+    }
+}
+
+std::uint32_t HashLife::join(std::uint32_t nw, std::uint32_t ne, std::uint32_t sw, std::uint32_t se)
+{
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t i = hash4(nw, ne, sw, se) & mask;
+    while (slots_[i] != kNone) {
+        const Node& n = nodes_[slots_[i]];
+        if (n.nw == nw && n.ne == ne && n.sw == sw && n.se == se)
+            return slots_[i];
+        i = (i + 1) & mask;
+    }
+
+    const Node node{nw, ne, sw, se, kNone, nodes_[nw].level + 1,
+                    nodes_[nw].population + nodes_[ne].population
+                        + nodes_[sw].population + nodes_[se].population};
+    std::uint32_t id;
+    if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+        nodes_[id] = node;
+    } else {
+        id = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.push_back(node);
+    }
+    slots_[i] = id;
+    if (++used_slots_ * 2 > slots_.size())
+        rehash(slots_.size() * 2);
+    return id;
+}
+
+std::uint32_t HashLife::empty(std::uint32_t level)
+{
+    while (empty_.size() <= level) {
+        const std::uint32_t e = empty_.back();
+        empty_.push_back(join(e, e, e, e));
+    }
+    return empty_[level];
+}
+
+std::uint32_t HashLife::centre(std::uint32_t n)
+{
+    const Node m = nodes_[n];
+    return join(nodes_[m.nw].se, nodes_[m.ne].sw, nodes_[m.sw].ne, nodes_[m.se].nw);
+}
+
+std::uint32_t HashLife::base_step(std::uint32_t n)
+{
+    const Node m = nodes_[n];
+    auto quad = [this](std::uint32_t q, int shift) {
+        const Node& c = nodes_[q];
+        return (c.nw << shift) | (c.ne << (shift + 1)) | (c.sw << (shift + 4)) | (c.se << (shift + 5));
+    };
+    const unsigned bits = quad(m.nw, 0) | quad(m.ne, 2) | quad(m.sw, 8) | quad(m.se, 10);
+    const std::uint8_t r = base_table_[bits];
+    return join(r & 1u, (r >> 1) & 1u, (r >> 2) & 1u, (r >> 3) & 1u);
+}
+
+std::uint32_t HashLife::successor(std::uint32_t n, unsigned j)
+{
+    const Node m = nodes_[n];
+    if (m.population == 0)
+        return m.nw;
+    if (m.result != kNone)
+        return m.result;
+
+    std::uint32_t result;
+    if (m.level == 2) {
+        result = base_step(n);
+    } else {
+        // Everything this frame holds is pinned, so a collection started
+        // further down the recursion keeps it.
+        const std::size_t pinned = pinned_.size();
+        pinned_.push_back(n);
+        maybe_collect();
+        const Node a = nodes_[m.nw], b = nodes_[m.ne], c = nodes_[m.sw], d = nodes_[m.se];
+        std::uint32_t sub[9] = {
+            m.nw,
+            join(a.ne, b.nw, a.se, b.sw),
+            m.ne,
+            join(a.sw, a.se, c.nw, c.ne),
+            join(a.se, b.sw, c.ne, d.nw),
+            join(b.sw, b.se, d.nw, d.ne),
+            m.sw,
+            join(c.ne, d.nw, c.se, d.sw),
+            m.se,
+        };
+        // At full speed both halves of the jump recurse; otherwise the first
+        // half is just a spatial re-centring and only the second half steps.
+        const bool full = j == m.level - 2;
+        pinned_.insert(pinned_.end(), std::begin(sub), std::end(sub));
+        for (std::uint32_t& s : sub) {
+            s = full ? successor(s, j - 1) : centre(s);
+            pinned_.push_back(s);
+        }
+        const unsigned jj = full ? j - 1 : j;
+        std::uint32_t q[4];
+        for (int i = 0; i < 4; ++i) {
+            const int k = i / 2 * 3 + i % 2;
+            q[i] = successor(join(sub[k], sub[k + 1], sub[k + 3], sub[k + 4]), jj);
+            pinned_.push_back(q[i]);
+        }
+        result = join(q[0], q[1], q[2], q[3]);
+        pinned_.resize(pinned);
+    }
+    nodes_[n].result = result;
+    return result;
+}
+
+std::uint32_t HashLife::set_rec(std::uint32_t n, std::int64_t x, std::int64_t y, bool alive)
+{
+    const Node m = nodes_[n];
+    if (m.level == 0)
+        return alive ? 1u : 0u;
+    const std::int64_t half = std::int64_t{1} << (m.level - 1);
+    std::uint32_t q[4] = {m.nw, m.ne, m.sw, m.se};
+    const int idx = (y >= half ? 2 : 0) + (x >= half ? 1 : 0);
+    q[idx] = set_rec(q[idx], x % half, y % half, alive);
+    return join(q[0], q[1], q[2], q[3]);
+}
+
+void HashLife::set_cell(std::int64_t x, std::int64_t y, bool alive)
+{
+    for (;;) {
+        const std::int64_t half = static_cast<std::int64_t>(root_half());
+        if (x >= -half && x < half && y >= -half && y < half)
+            break;
+        expand();
+    }
+    const std::int64_t half = static_cast<std::int64_t>(root_half());
+    root_ = set_rec(root_, x + half, y + half, alive);
+}
+
+bool HashLife::get_cell(std::int64_t x, std::int64_t y) const
+{
+    std::int64_t half = static_cast<std::int64_t>(root_half());
+    if (x < -half || x >= half || y < -half || y >= half)
+        return false;
+    x += half;
+    y += half;
+    std::uint32_t n = root_;
+    while (nodes_[n].level > 0) {
+        const Node& m = nodes_[n];
+        if (m.population == 0)
+            return false;
+        half = std::int64_t{1} << (m.level - 1);
+        const bool east = x >= half, south = y >= half;
+        n = south ? (east ? m.se : m.sw) : (east ? m.ne : m.nw);
+        x %= half;
+        y %= half;
+    }
+    return n == 1;
+}
+
+std::uint32_t HashLife::leaf8(std::uint64_t bits)
+{
+    auto cell = [bits](int x, int y) { return static_cast<std::uint32_t>((bits >> (y * 8 + x)) & 1u); };
+    auto l1 = [&](int x, int y) {
+        return join(cell(x, y), cell(x + 1, y), cell(x, y + 1), cell(x + 1, y + 1));
+    };
+    auto l2 = [&](int x, int y) {
+        const std::uint32_t nw = l1(x, y), ne = l1(x + 2, y), sw = l1(x, y + 2), se = l1(x + 2, y + 2);
+        return join(nw, ne, sw, se);
+    };
+    const std::uint32_t nw = l2(0, 0), ne = l2(4, 0), sw = l2(0, 4), se = l2(4, 4);
+    return join(nw, ne, sw, se);
+}
+
+void HashLife::load_macrocell(const std::vector<MacrocellNode>& nodes)
+{
+    std::vector<std::uint32_t> ids(nodes.size(), 0);
+    for (std::size_t i = 1; i < nodes.size(); ++i) {
+        const MacrocellNode& n = nodes[i];
+        if (n.level == 3) {
+            ids[i] = leaf8(n.leaf);
+            continue;
+        }
+        const std::uint32_t e = empty(n.level - 1);
+        auto child = [&](std::uint32_t c) { return c ? ids[c] : e; };
+        ids[i] = join(child(n.nw), child(n.ne), child(n.sw), child(n.se));
+    }
+    root_ = ids.back();
+    generation_ = 0;
+}
+
+void HashLife::expand()
+{
+    const Node r = nodes_[root_];
+    const std::uint32_t e = empty(r.level - 1);
+    const std::uint32_t nw = join(e, e, e, r.nw);
+    const std::uint32_t ne = join(e, e, r.ne, e);
+    const std::uint32_t sw = join(e, r.sw, e, e);
+    const std::uint32_t se = join(r.se, e, e, e);
+    root_ = join(nw, ne, sw, se);
+}
+
+bool HashLife::centred() const
+{
+    const Node& r = nodes_[root_];
+    const Node &a = nodes_[r.nw], &b = nodes_[r.ne], &c = nodes_[r.sw], &d = nodes_[r.se];
+    const std::uint64_t inner = nodes_[a.se].population + nodes_[b.sw].population
+        + nodes_[c.ne].population + nodes_[d.nw].population;
+    return inner == r.population;
+}
+
+void HashLife::set_step(unsigned k)
+{
+    if (k == step_log2_)
+        return;
+    // A node at level L caches a 2^min(k, L - 2) jump, so only levels whose
+    // jump actually differs between the old and new exponent are stale.
+    const unsigned keep = std::min(k, step_log2_) + 2;
+    for (Node& n : nodes_)
+        if (n.level > keep)
+            n.result = kNone;
+    step_log2_ = k;
+}
+
+void HashLife::maybe_collect()
+{
+    if (memory_bytes() > next_gc_bytes_)
+        collect_garbage();
+}
+
+void HashLife::step_pow2(unsigned k)
+{
+    maybe_collect();
+    set_step(k);
+    while (nodes_[root_].level < k + 3 || !centred())
+        expand();
+    expand();
+    root_ = successor(root_, k);
+    generation_ += std::uint64_t{1} << k;
+}
+
+void HashLife::run(std::uint64_t generations)
+{
+    for (int bit = 63; bit >= 0; --bit)
+        if ((generations >> bit) & 1u)
+            step_pow2(static_cast<unsigned>(bit));
+}
+
+void HashLife::collect_garbage()
+{
+    std::vector<bool> marked(nodes_.size(), false);
+    marked[0] = marked[1] = true;
+    std::vector<std::uint32_t> stack(empty_.begin(), empty_.end());
+    stack.insert(stack.end(), pinned_.begin(), pinned_.end());
+    stack.push_back(root_);
+    while (!stack.empty()) {
+        const std::uint32_t id = stack.back();
+        stack.pop_back();
+        if (marked[id])
+            continue;
+        marked[id] = true;
+        const Node& n = nodes_[id];
+        stack.insert(stack.end(), {n.nw, n.ne, n.sw, n.se});
+    }
+
+    free_.clear();
+    for (std::uint32_t id = 2; id < nodes_.size(); ++id) {
+        Node& n = nodes_[id];
+        if (!marked[id]) {
+            n = {kNone, kNone, kNone, kNone, kNone, 0, 0};
+            free_.push_back(id);
+        } else if (n.result != kNone && !marked[n.result]) {
+            n.result = kNone;
+        }
+    }
+    std::size_t slots = 1024;
+    while (slots < node_count() * 4)
+        slots *= 2;
+    rehash(slots);
+    // If more than the limit is still live, let the table double before
+    // trying again rather than collecting on every step of the recursion.
+    next_gc_bytes_ = std::max(memory_limit_, 2 * memory_bytes());
+    ++gc_runs_;
+}
+
+std::int64_t HashLife::inset(std::uint32_t n, bool vertical, bool from_high,
+                             std::unordered_map<std::uint32_t, std::int64_t>& memo) const
+{
+    const Node& m = nodes_[n];
+    if (m.population == 0)
+        return -1;
+    if (m.level == 0)
+        return 0;
+    if (const auto it = memo.find(n); it != memo.end())
+        return it->second;
+
+    // Quadrants on the requested edge first; the far ones only if those are
+    // empty, offset by half the node.
+    std::uint32_t near[2], far[2];
+    if (vertical) {
+        near[0] = from_high ? m.sw : m.nw, near[1] = from_high ? m.se : m.ne;
+        far[0] = from_high ? m.nw : m.sw, far[1] = from_high ? m.ne : m.se;
+    } else {
+        near[0] = from_high ? m.ne : m.nw, near[1] = from_high ? m.se : m.sw;
+        far[0] = from_high ? m.nw : m.ne, far[1] = from_high ? m.sw : m.se;
+    }
+    auto best = [&](const std::uint32_t (&q)[2]) {
+        const std::int64_t a = inset(q[0], vertical, from_high, memo);
+        const std::int64_t b = inset(q[1], vertical, from_high, memo);
+        return a < 0 ? b : (b < 0 ? a : std::min(a, b));
+    };
+    std::int64_t result = best(near);
+    if (result < 0)
+        result = (std::int64_t{1} << (m.level - 1)) + best(far);
+    memo.emplace(n, result);
+    return result;
+}
+
+bool HashLife::bounds(std::int64_t& x0, std::int64_t& y0, std::int64_t& x1, std::int64_t& y1) const
+{
+    if (population() == 0)
+        return false;
+    const std::int64_t half = static_cast<std::int64_t>(root_half());
+    std::unordered_map<std::uint32_t, std::int64_t> memo;
+    x0 = -half + inset(root_, false, false, memo);
+    memo.clear();
+    x1 = half - inset(root_, false, true, memo);
+    memo.clear();
+    y0 = -half + inset(root_, true, false, memo);
+    memo.clear();
+    y1 = half - inset(root_, true, true, memo);
+    return true;
+}
+
+void HashLife::row_runs(std::uint32_t n, std::int64_t x, std::int64_t y, std::int64_t row,
+                        std::int64_t x0, RleWriter& rle) const
+{
+    const Node& m = nodes_[n];
+    if (m.population == 0)
+        return;
+    if (m.level == 0) {
+        rle.live(x - x0, 1);
+        return;
+    }
+    const std::int64_t h = std::int64_t{1} << (m.level - 1);
+    if (row < y + h) {
+        row_runs(m.nw, x, y, row, x0, rle);
+        row_runs(m.ne, x + h, y, row, x0, rle);
+    } else {
+        row_runs(m.sw, x, y + h, row, x0, rle);
+        row_runs(m.se, x + h, y + h, row, x0, rle);
+    }
+}
+
+void HashLife::write_rle(BufferedWriter& out) const
+{
+    std::int64_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    bounds(x0, y0, x1, y1);
+    RleWriter rle(out, x1 - x0, y1 - y0, rule_);
+    const std::int64_t half = static_cast<std::int64_t>(root_half());
+    for (std::int64_t row = y0; row < y1; ++row) {
+        if (row != y0)
+            rle.next_row();
+        row_runs(root_, -half, -half, row, x0, rle);
+    }
+    rle.finish();
+}
+
+std::uint64_t HashLife::leaf_bits(std::uint32_t n) const
+{
+    // Gathers a level-3 node into an 8x8 bitmap, bit y * 8 + x.
+    std::uint64_t bits = 0;
+    struct Item {
+        std::uint32_t node;
+        int x, y;
+    };
+    Item stack[32];
+    int top = 0;
+    stack[top++] = {n, 0, 0};
+    while (top > 0) {
+        const Item it = stack[--top];
+        const Node& m = nodes_[it.node];
+        if (m.population == 0)
+            continue;
+        if (m.level == 0) {
+            bits |= std::uint64_t{1} << (it.y * 8 + it.x);
+            continue;
+        }
+        const int h = 1 << (m.level - 1);
+        stack[top++] = {m.nw, it.x, it.y};
+        stack[top++] = {m.ne, it.x + h, it.y};
+        stack[top++] = {m.sw, it.x, it.y + h};
+        stack[top++] = {m.se, it.x + h, it.y + h};
+    }
+    return bits;
+}
+
+void HashLife::write_macrocell(BufferedWriter& out) const
+{
+    out.write("[M2] (bash-conway)\n#R ");
+    out.write(rule_.to_string());
+    out.write("\n#G ");
+    out.write_uint(generation_);
+    out.put('\n');
+
+    std::unordered_map<std::uint32_t, std::uint64_t> ids;
+    std::uint64_t next_id = 1;
+    auto write_leaf = [&](std::uint64_t bits) {
+        for (int y = 0; y < 8 && (bits >> (y * 8)); ++y) {
+            const unsigned row = static_cast<unsigned>((bits >> (y * 8)) & 0xffu);
+            const int width = row ? 8 - std::countl_zero(static_cast<std::uint8_t>(row)) : 0;
+            for (int x = 0; x < width; ++x)
+                out.put((row >> x) & 1u ? '*' : '.');
+            out.put('$');
+        }
+        out.put('\n');
+    };
+
+    // Children before parents; recursion depth is bounded by the root level.
+    auto visit = [&](auto&& self, std::uint32_t n) -> std::uint64_t {
+        const Node& m = nodes_[n];
+        if (m.population == 0)
+            return 0;
+        if (const auto it = ids.find(n); it != ids.end())
+            return it->second;
+        if (m.level == 3) {
+            write_leaf(leaf_bits(n));
+        } else {
+            const std::uint64_t a = self(self, m.nw), b = self(self, m.ne);
+            const std::uint64_t c = self(self, m.sw), d = self(self, m.se);
+            out.write_uint(m.level);
+            for (std::uint64_t child : {a, b, c, d}) {
+                out.put(' ');
+                out.write_uint(child);
+            }
+            out.put('\n');
+        }
+        ids.emplace(n, next_id);
+        return next_id++;
+    };
+    if (visit(visit, root_) == 0)
+        write_leaf(0); // an empty universe is a single empty leaf
+}
+
+void HashLife::for_each_live(CellSink& sink) const
+{
+    struct Item {
+        std::uint32_t node;
+        std::int64_t x, y;
+    };
+    const std::int64_t half = static_cast<std::int64_t>(root_half());
+    std::vector<Item> stack{{root_, -half, -half}};
+    while (!stack.empty()) {
+        const Item it = stack.back();
+        stack.pop_back();
+        const Node& n = nodes_[it.node];
+        if (n.population == 0)
+            continue;
+        if (n.level == 0) {
+            sink.live_run(it.x, it.y, 1);
+            continue;
+        }
+        const std::int64_t h = std::int64_t{1} << (n.level - 1);
+        stack.push_back({n.se, it.x + h, it.y + h});
+        stack.push_back({n.sw, it.x, it.y + h});
+        stack.push_back({n.ne, it.x + h, it.y});
+        stack.push_back({n.nw, it.x, it.y});
+    }
+}
+
+} // namespace conway
@@ -0,0 +1,126 @@
+#include "conway/kernel.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace conway {
+
+namespace kernels {
+#define CONWAY_DECLARE_ROW_KERNEL(isa, variant)                                                   \
+    void step_row_##isa##_##variant(const std::uint64_t*, const std::uint64_t*,                   \
+                                    const std::uint64_t*, std::uint64_t*, std::size_t,            \
+                                    std::size_t, std::size_t, const CompiledRule&);
+#define CONWAY_DECLARE_ROW_KERNELS(isa)                                                           \
+    CONWAY_DECLARE_ROW_KERNEL(isa, life)                                                          \
+    CONWAY_DECLARE_ROW_KERNEL(isa, highlife)                                                      \
+    CONWAY_DECLARE_ROW_KERNEL(isa, daynight)                                                      \
+    CONWAY_DECLARE_ROW_KERNEL(isa, table)                                                         \
+    CONWAY_DECLARE_ROW_KERNEL(isa, decision)
+CONWAY_DECLARE_ROW_KERNELS(scalar)
+#ifdef CONWAY_HAVE_AVX2
+CONWAY_DECLARE_ROW_KERNELS(avx2)
+#endif
+#ifdef CONWAY_HAVE_AVX512
+CONWAY_DECLARE_ROW_KERNELS(avx512)
+#endif
+#undef CONWAY_DECLARE_ROW_KERNELS
+#undef CONWAY_DECLARE_ROW_KERNEL
+} // namespace kernels
+
+namespace {
+
+/// Rules with a kernel specialised at compile time, in IsaEntry::special order.
+struct SpecialRule {
+    const char* variant;
+    Rule rule;
+};
+
+constexpr SpecialRule kSpecialRules[] = {
+    {"life", Rule::life()},
+    {"highlife", Rule::highlife()},
+    {"daynight", Rule::day_and_night()},
+};
+
+constexpr std::size_t kSpecialCount = sizeof kSpecialRules / sizeof kSpecialRules[0];
+
+struct IsaEntry {
+    const char* name;
+    RowKernelFn special[kSpecialCount];
+    RowKernelFn table;
+    RowKernelFn decision;
+    std::size_t lanes;
+    bool supported;
+};
+
+#define CONWAY_ISA_KERNELS(isa)                                                                   \
+    {kernels::step_row_##isa##_life, kernels::step_row_##isa##_highlife,                          \
+     kernels::step_row_##isa##_daynight},                                                         \
+        kernels::step_row_##isa##_table, kernels::step_row_##isa##_decision
+
+std::vector<IsaEntry> isa_table()
+{
+    std::vector<IsaEntry> out;
+#ifdef CONWAY_HAVE_AVX512
+    out.push_back({"avx512", CONWAY_ISA_KERNELS(avx512), 8,
+                   static_cast<bool>(__builtin_cpu_supports("avx512f"))});
+#endif
+#ifdef CONWAY_HAVE_AVX2
+    out.push_back({"avx2", CONWAY_ISA_KERNELS(avx2), 4,
+                   static_cast<bool>(__builtin_cpu_supports("avx2"))});
+#endif
+    out.push_back({"scalar", CONWAY_ISA_KERNELS(scalar), 1, true});
+    return out;
+}
+
+#undef CONWAY_ISA_KERNELS
+
+} // namespace
+
+std::vector<std::string_view> available_isas()
+{
+    std::vector<std::string_view> out;
+    for (const IsaEntry& e : isa_table())
+        if (e.supported)
+            out.push_back(e.name);
+    return out;
+}
+
+RowKernel select_kernel(std::string_view name, const Rule& rule, bool specialise)
+{
+    if (name.empty() || name == "auto") {
+        const char* env = std::getenv("CONWAY_KERNEL");
+        name = env && *env ? env : "auto";
+    }
+    for (const IsaEntry& e : isa_table()) {
+        if (!e.supported || (name != "auto" && name != e.name))
+            continue;
+        if (!rule.totalistic())
+            return {e.name, "decision", e.decision, e.lanes};
+        for (std::size_t i = 0; specialise && i < kSpecialCount; ++i)
+            if (rule == kSpecialRules[i].rule)
+                return {e.name, kSpecialRules[i].variant, e.special[i], e.lanes};
+        return {e.name, "table", e.table, e.lanes};
+    }
+    throw std::runtime_error("kernel '" + std::string(name) + "' is not available on this CPU/build");
+}
+
+std::vector<RowKernel> kernels_for(std::string_view isa, const Rule& rule)
+{
+    std::vector<RowKernel> out;
+    for (const IsaEntry& e : isa_table()) {
+        if (!e.supported || isa != e.name)
+            continue;
+        for (std::size_t i = 0; i < kSpecialCount; ++i)
+            if (rule == kSpecialRules[i].rule)
+                out.push_back({e.name, kSpecialRules[i].variant, e.special[i], e.lanes});
+        if (rule.totalistic())
+            out.push_back({e.name, "table", e.table, e.lanes});
+        out.push_back({e.name, "decision", e.decision, e.lanes});
+    }
+    if (out.empty())
+        throw std::runtime_error("kernel '" + std::string(isa) + "' is not available on this CPU/build");
+    return out;
+}
+
+} // namespace conway
@@ -0,0 +1,12 @@
+// Compiled with -mavx2; only reached after a runtime CPU check.
+#define CONWAY_ISA_NAMESPACE avx2
+#include "conway/rule.hpp"
+#include "kernels/row_kernel.hpp"
+
+namespace conway::kernels {
+
+using V256 = std::uint64_t __attribute__((vector_size(32)));
+
+CONWAY_DEFINE_ROW_KERNELS(avx2, V256, 4)
+
+} // namespace conway::kernels
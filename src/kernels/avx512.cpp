@@ -0,0 +1,12 @@
+// Compiled with -mavx512f; only reached after a runtime CPU check.
+#define CONWAY_ISA_NAMESPACE avx512
+#include "conway/rule.hpp"
+#include "kernels/row_kernel.hpp"
+
+namespace conway::kernels {
+
+using V512 = std::uint64_t __attribute__((vector_size(64)));
+
+CONWAY_DEFINE_ROW_KERNELS(avx512, V512, 8)
+
+} // namespace conway::kernels
@@ -0,0 +1,160 @@
+#pragma once
+
+// Each kernel translation unit defines CONWAY_ISA_NAMESPACE to its ISA name
+// before any include (see conway/bitlife.hpp), so the templates here are
+// compiled into a namespace of its own and never merge across ISAs.
+#ifndef CONWAY_ISA_NAMESPACE
+#error "kernel translation units define CONWAY_ISA_NAMESPACE before any include"
+#endif
+
+#include "conway/bitlife.hpp"
+#include "conway/kernel.hpp"
+#include "conway/rule.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace conway::kernels {
+
+inline namespace CONWAY_ISA_NAMESPACE {
+
+template <class V>
+inline V load(const std::uint64_t* p)
+{
+    V v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+template <class V>
+inline void store(std::uint64_t* p, V v)
+{
+    std::memcpy(p, &v, sizeof v);
+}
+
+template <class Eval>
+inline void step_words_scalar(const Eval& eval, const std::uint64_t* up, const std::uint64_t* mid,
+                              const std::uint64_t* down, std::uint64_t* out,
+                              std::size_t words, std::size_t begin, std::size_t end)
+{
+    for (std::size_t i = begin; i < end; ++i) {
+        const std::size_t l = i == 0 ? words - 1 : i - 1;
+        const std::size_t r = i + 1 == words ? 0 : i + 1;
+        out[i] = next_word(eval, up[l], up[i], up[r],
+                           mid[l], mid[i], mid[r],
+                           down[l], down[i], down[r]);
+    }
+}
+
+/// Row kernel over a vector of N words. Interior words read their west and
+/// east neighbours with unaligned loads shifted by one word; the first and
+/// last word of the row (where the torus wraps) and any ragged tail go
+/// through the scalar path, which shares the same adder template.
+template <class V, std::size_t N, class Eval>
+void step_words_simd(const Eval& eval, const std::uint64_t* up, const std::uint64_t* mid,
+                     const std::uint64_t* down, std::uint64_t* out,
+                     std::size_t words, std::size_t begin, std::size_t end)
+{
+    const std::size_t lo = begin > 0 ? begin : 1;
+    const std::size_t hi = end < words ? end : words - 1;
+    if (lo + N > hi) {
+        step_words_scalar(eval, up, mid, down, out, words, begin, end);
+        return;
+    }
+    step_words_scalar(eval, up, mid, down, out, words, begin, lo);
+    std::size_t i = lo;
+    for (; i + N <= hi; i += N) {
+        const V r = next_word(eval,
+                              load<V>(up + i - 1), load<V>(up + i), load<V>(up + i + 1),
+                              load<V>(mid + i - 1), load<V>(mid + i), load<V>(mid + i + 1),
+                              load<V>(down + i - 1), load<V>(down + i), load<V>(down + i + 1));
+        store(out + i, r);
+    }
+    step_words_scalar(eval, up, mid, down, out, words, i, end);
+}
+
+/// Decision-diagram rules run node by node over blocks of words rather than
+/// word by word: the nine input planes of a block are built once, then each
+/// node is a straight streaming loop over its three operand rows, so the
+/// per-node bookkeeping is paid once per block instead of once per word.
+template <class V, std::size_t N>
+void step_words_simd(const DecisionEval& eval, const std::uint64_t* up, const std::uint64_t* mid,
+                     const std::uint64_t* down, std::uint64_t* out,
+                     std::size_t words, std::size_t begin, std::size_t end)
+{
+    constexpr std::size_t kBlock = 32;
+    alignas(64) std::uint64_t slot[DecisionEval::kMaxSlots][kBlock];
+    // Plain loops and memcpy rather than <algorithm>: its instantiations
+    // are shared with every other translation unit, and this copy would
+    // carry the ISA flags.
+    for (std::size_t j = 0; j < kBlock; ++j) {
+        slot[0][j] = 0;
+        slot[1][j] = ~std::uint64_t{0};
+    }
+    const DecisionEval::Node* const nodes = eval.nodes.data();
+    const std::size_t node_count = eval.nodes.size();
+    for (std::size_t i0 = begin; i0 < end; i0 += kBlock) {
+        const std::size_t n = end - i0 < kBlock ? end - i0 : kBlock;
+        const std::size_t padded = (n + N - 1) / N * N;
+        const std::uint64_t* rows[3] = {up, mid, down};
+        for (std::size_t j = 0; j < n;) {
+            const std::size_t i = i0 + j;
+            if (i > 0 && i + N < words && j + N <= n) {
+                for (int y = 0; y < 3; ++y) {
+                    const V c = load<V>(rows[y] + i);
+                    store(slot[2 + 3 * y] + j, west_of(load<V>(rows[y] + i - 1), c));
+                    store(slot[3 + 3 * y] + j, c);
+                    store(slot[4 + 3 * y] + j, east_of(c, load<V>(rows[y] + i + 1)));
+                }
+                j += N;
+                continue;
+            }
+            const std::size_t l = i == 0 ? words - 1 : i - 1;
+            const std::size_t r = i + 1 == words ? 0 : i + 1;
+            for (int y = 0; y < 3; ++y) {
+                slot[2 + 3 * y][j] = west_of(rows[y][l], rows[y][i]);
+                slot[3 + 3 * y][j] = rows[y][i];
+                slot[4 + 3 * y][j] = east_of(rows[y][i], rows[y][r]);
+            }
+            ++j;
+        }
+        for (std::size_t b = 2; b < DecisionEval::kFirstNode; ++b)
+            for (std::size_t j = n; j < padded; ++j)
+                slot[b][j] = 0;
+        for (std::size_t k = 0; k < node_count; ++k) {
+            const DecisionEval::Node& node = nodes[k];
+            for (std::size_t j = 0; j < padded; j += N) {
+                const V lo = load<V>(slot[node.lo] + j);
+                store(slot[node.dst] + j, lo ^ ((lo ^ load<V>(slot[node.hi] + j)) & load<V>(slot[node.var] + j)));
+            }
+        }
+        std::memcpy(out + i0, slot[eval.result], n * sizeof out[0]);
+    }
+}
+
+} // namespace CONWAY_ISA_NAMESPACE
+
+/// Defines the entry points of one ISA: one per rule specialised at
+/// compile time, plus the rule-table and decision-diagram kernels. Each kernel translation unit
+/// invokes it once with its vector type and width.
+#define CONWAY_DEFINE_ROW_KERNEL(isa, variant, V, N, eval)                                        \
+    void step_row_##isa##_##variant(const std::uint64_t* up, const std::uint64_t* mid,            \
+                                    const std::uint64_t* down, std::uint64_t* out,                \
+                                    std::size_t words, std::size_t begin, std::size_t end,        \
+                                    [[maybe_unused]] const CompiledRule& rule)                    \
+    {                                                                                             \
+        step_words_simd<V, N>(eval, up, mid, down, out, words, begin, end);                       \
+    }
+
+#define CONWAY_DEFINE_ROW_KERNELS(isa, V, N)                                                      \
+    CONWAY_DEFINE_ROW_KERNEL(isa, life, V, N, LifeEval{})                                         \
+    CONWAY_DEFINE_ROW_KERNEL(isa, highlife, V, N,                                                 \
+                             (FixedEval<Rule::highlife().birth, Rule::highlife().survive>{}))     \
+    CONWAY_DEFINE_ROW_KERNEL(isa, daynight, V, N,                                                 \
+                             (FixedEval<Rule::day_and_night().birth,                              \
+                                        Rule::day_and_night().survive>{}))                        \
+    CONWAY_DEFINE_ROW_KERNEL(isa, table, V, N, rule.table)                                        \
+    CONWAY_DEFINE_ROW_KERNEL(isa, decision, V, N, rule.decision)
+
+} // namespace conway::kernels
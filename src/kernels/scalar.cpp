@@ -0,0 +1,10 @@
+#define CONWAY_ISA_NAMESPACE scalar
+#include "conway/rule.hpp"
+#include "kernels/row_kernel.hpp"
+
+namespace conway::kernels {
+
+// A one-lane "vector" is just the scalar loop.
+CONWAY_DEFINE_ROW_KERNELS(scalar, std::uint64_t, 1)
+
+} // namespace conway::kernels
@@ -0,0 +1,401 @@
+#include "conway/ltl_engine.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+namespace conway {
+
+namespace {
+
+std::size_t wrap(std::int64_t v, std::size_t n)
+{
+    const auto m = static_cast<std::int64_t>(n);
+    v %= m;
+    return static_cast<std::size_t>(v < 0 ? v + m : v);
+}
+
+/// Parses a whole decimal field, or throws.
+unsigned parse_number(std::string_view field, std::string_view text)
+{
+    unsigned v = 0;
+    const auto r = std::from_chars(field.data(), field.data() + field.size(), v);
+    if (field.empty() || r.ec != std::errc() || r.ptr != field.data() + field.size())
+        throw std::runtime_error("bad Larger than Life rule '" + std::string(text) + "'");
+    return v;
+}
+
+/// "<a>..<b>" into min and max.
+void parse_interval(std::string_view field, std::string_view text, unsigned& lo, unsigned& hi)
+{
+    const std::size_t dots = field.find("..");
+    if (dots == std::string_view::npos)
+        throw std::runtime_error("bad Larger than Life rule '" + std::string(text) + "'");
+    lo = parse_number(field.substr(0, dots), text);
+    hi = parse_number(field.substr(dots + 2), text);
+}
+
+} // namespace
+
+bool LtlRule::is_ltl(std::string_view text)
+{
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+        text.remove_prefix(1);
+    return text.size() >= 2 && (text[0] == 'R' || text[0] == 'r')
+        && std::isdigit(static_cast<unsigned char>(text[1]));
+}
+
+LtlRule LtlRule::parse(std::string_view text)
+{
+    std::string s;
+    for (char ch : text)
+        if (!std::isspace(static_cast<unsigned char>(ch)))
+            s.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(ch))));
+
+    LtlRule rule;
+    bool have_range = false, have_survive = false, have_birth = false;
+    std::size_t pos = 0;
+    while (pos <= s.size()) {
+        std::size_t comma = s.find(',', pos);
+        if (comma == std::string::npos)
+            comma = s.size();
+        const std::string_view field = std::string_view(s).substr(pos, comma - pos);
+        pos = comma + 1;
+        if (field.empty())
+            throw std::runtime_error("bad Larger than Life rule '" + std::string(text) + "'");
+        const std::string_view value = field.substr(1);
+        switch (field[0]) {
+        case 'R':
+            rule.range = parse_number(value, text);
+            have_range = true;
+            break;
+        case 'C': {
+            const unsigned c = parse_number(value, text);
+            if (c > 256)
+                throw std::runtime_error("Larger than Life rules have at most 256 states");
+            rule.states = static_cast<std::uint16_t>(std::max(c, 2u));
+            break;
+        }
+        case 'M':
+            if (value != "0" && value != "1")
+                throw std::runtime_error("bad Larger than Life rule '" + std::string(text) + "'");
+            rule.middle = value == "1";
+            break;
+        case 'S':
+            parse_interval(value, text, rule.survive_min, rule.survive_max);
+            have_survive = true;
+            break;
+        case 'B':
+            parse_interval(value, text, rule.birth_min, rule.birth_max);
+            have_birth = true;
+            break;
+        case 'N':
+            if (value == "M")
+                rule.neighbourhood = Neighbourhood::moore;
+            else if (value == "N")
+                rule.neighbourhood = Neighbourhood::von_neumann;
+            else
+                throw std::runtime_error("unknown Larger than Life neighbourhood '" + std::string(value) + "'");
+            break;
+        default:
+            throw std::runtime_error("bad Larger than Life rule '" + std::string(text) + "'");
+        }
+    }
+    if (!have_range || !have_survive || !have_birth)
+        throw std::runtime_error("Larger than Life rule '" + std::string(text) + "' needs R, S and B");
+    if (rule.survive_min > rule.survive_max || rule.birth_min > rule.birth_max)
+        throw std::runtime_error("empty interval in Larger than Life rule '" + std::string(text) + "'");
+    if (rule.range < 1 || rule.range > kMaxRange)
+        throw std::runtime_error("Larger than Life range must lie in 1.." + std::to_string(kMaxRange));
+    return rule;
+}
+
+std::string LtlRule::to_string() const
+{
+    std::string out = "R";
+    out += std::to_string(range);
+    out += ",C";
+    out += std::to_string(states == 2 ? 0 : states);
+    out += middle ? ",M1" : ",M0";
+    out += ",S";
+    out += std::to_string(survive_min);
+    out += "..";
+    out += std::to_string(survive_max);
+    out += ",B";
+    out += std::to_string(birth_min);
+    out += "..";
+    out += std::to_string(birth_max);
+    out += neighbourhood == Neighbourhood::moore ? ",NM" : ",NN";
+    return out;
+}
+
+unsigned LtlRule::neighbourhood_size() const
+{
+    const unsigned side = 2 * range + 1;
+    return neighbourhood == Neighbourhood::moore ? side * side : 2 * range * (range + 1) + 1;
+}
+
+LtlEngine::LtlEngine(std::size_t width, std::size_t height, const LtlRule& rule)
+    : rule_(rule)
+    , width_((width + 63) / 64 * 64)
+    , height_(height)
+    , cells_(width_ * height_)
+    , next_(width_ * height_)
+{
+    if (width_ == 0 || height_ == 0)
+        throw std::runtime_error("empty board");
+    const std::size_t r = rule.range;
+    if (rule.neighbourhood == LtlRule::Neighbourhood::moore) {
+        ring_.resize((2 * r + 1) * width_);
+        ring2_.resize(width_);
+        scratch_.resize(width_ + 2 * r + 1);
+    } else {
+        const std::size_t padded = width_ + 2 * (r + 1);
+        ring_.resize((2 * r + 3) * padded);
+        ring2_.resize((2 * r + 3) * padded);
+        scratch_.resize(padded + 1);
+    }
+    counts_.resize(width_);
+}
+
+void LtlEngine::set_state(std::size_t x, std::size_t y, unsigned state)
+{
+    if (state >= rule_.states)
+        throw std::runtime_error("state out of range for " + rule_.to_string());
+    cells_[y * width_ + x] = static_cast<std::uint8_t>(state);
+}
+
+void LtlEngine::padded_row(std::int64_t y, std::size_t pad, std::uint16_t* out) const
+{
+    const std::uint8_t* row = cells_.data() + wrap(y, height_) * width_;
+    for (std::size_t i = 0; i < pad; ++i)
+        out[i] = row[width_ - pad + i] == 1;
+    for (std::size_t x = 0; x < width_; ++x)
+        out[pad + x] = row[x] == 1;
+    for (std::size_t i = 0; i < pad; ++i)
+        out[pad + width_ + i] = row[i] == 1;
+}
+
+void LtlEngine::window_row(std::size_t y, std::uint16_t* out)
+{
+    // Prefix sum over the padded row, then one subtraction per cell.
+    const std::size_t r = rule_.range;
+    std::uint16_t* p = scratch_.data();
+    padded_row(static_cast<std::int64_t>(y), r, p + 1);
+    p[0] = 0;
+    for (std::size_t i = 1; i <= width_ + 2 * r; ++i)
+        p[i] = static_cast<std::uint16_t>(p[i] + p[i - 1]);
+    for (std::size_t x = 0; x < width_; ++x)
+        out[x] = static_cast<std::uint16_t>(p[x + 2 * r + 1] - p[x]);
+}
+
+void LtlEngine::update_row(std::size_t y, const std::uint16_t* counts)
+{
+    const std::uint8_t* cur = cells_.data() + y * width_;
+    std::uint8_t* next = next_.data() + y * width_;
+    // Everything in 16 bits, selected with masks rather than branches, and
+    // the width in a local (byte stores may alias it) so the loop vectorises. Counts outside an
+    // interval wrap to large values and fail the span test.
+    using u16 = std::uint16_t;
+    const u16 self = rule_.middle ? 0 : 1;
+    const u16 b_lo = static_cast<u16>(rule_.birth_min);
+    const u16 b_span = static_cast<u16>(rule_.birth_max - rule_.birth_min);
+    const u16 s_lo = static_cast<u16>(rule_.survive_min);
+    const u16 s_span = static_cast<u16>(rule_.survive_max - rule_.survive_min);
+    const u16 states = rule_.states;
+    const u16 decay = states > 2 ? 2 : 0;
+    const std::size_t width = width_;
+    for (std::size_t x = 0; x < width; ++x) {
+        const u16 s = cur[x];
+        const u16 alive = s == 1;
+        const u16 c = static_cast<u16>(counts[x] - (alive & self));
+        const u16 born = static_cast<u16>(c - b_lo) <= b_span;
+        const u16 survives = static_cast<u16>(c - s_lo) <= s_span;
+        const u16 older = static_cast<u16>((s + 1) & -static_cast<u16>(s + 1 != states));
+        const u16 live_next = static_cast<u16>(survives | (decay & (survives - 1)));
+        const u16 dead_mask = static_cast<u16>(-static_cast<u16>(s == 0));
+        const u16 alive_mask = static_cast<u16>(-alive);
+        next[x] = static_cast<std::uint8_t>((born & dead_mask) | (live_next & alive_mask)
+                                            | (older & ~(dead_mask | alive_mask)));
+    }
+}
+
+void LtlEngine::step_moore()
+{
+    const std::size_t r = rule_.range;
+    const std::size_t k = 2 * r + 1;
+    const std::int64_t range = static_cast<std::int64_t>(r);
+    auto slot = [&](std::int64_t j) { return ring_.data() + wrap(j, k) * width_; };
+
+    // Running vertical sum of the window rows y - R .. y + R.
+    std::uint16_t* sum = counts_.data();
+    std::fill(counts_.begin(), counts_.end(), 0);
+    for (std::int64_t j = -range; j <= range; ++j) {
+        std::uint16_t* w = slot(j);
+        window_row(wrap(j, height_), w);
+        for (std::size_t x = 0; x < width_; ++x)
+            sum[x] = static_cast<std::uint16_t>(sum[x] + w[x]);
+    }
+    std::uint16_t* fresh = ring2_.data();
+    for (std::size_t y = 0; y < height_; ++y) {
+        update_row(y, sum);
+        if (y + 1 == height_)
+            break;
+        // Row y + R + 1 enters and takes the slot of row y - R.
+        const std::int64_t j = static_cast<std::int64_t>(y) + range + 1;
+        std::uint16_t* old = slot(j);
+        window_row(wrap(j, height_), fresh);
+        for (std::size_t x = 0; x < width_; ++x) {
+            sum[x] = static_cast<std::uint16_t>(sum[x] + fresh[x] - old[x]);
+            old[x] = fresh[x];
+        }
+    }
+}
+
+void LtlEngine::step_von_neumann()
+{
+    const std::size_t r = rule_.range;
+    const std::int64_t range = static_cast<std::int64_t>(r);
+    const std::size_t pad = r + 1;
+    const std::size_t padded = width_ + 2 * pad;
+    const std::size_t k = 2 * r + 3;
+    // a: prefix sums down the (+1, +1) diagonals; b: down the (-1, +1)
+    // diagonals. Both are taken modulo 2^16, which differences of at most
+    // R + 1 cells survive intact.
+    auto a = [&](std::int64_t j) { return ring_.data() + wrap(j, k) * padded; };
+    auto b = [&](std::int64_t j) { return ring2_.data() + wrap(j, k) * padded; };
+    std::uint16_t* live = scratch_.data();
+    auto diagonal_row = [&](std::int64_t j) {
+        padded_row(j, pad, live);
+        const std::uint16_t* pa = a(j - 1);
+        const std::uint16_t* pb = b(j - 1);
+        std::uint16_t* na = a(j);
+        std::uint16_t* nb = b(j);
+        na[0] = live[0];
+        for (std::size_t i = 1; i < padded; ++i)
+            na[i] = static_cast<std::uint16_t>(live[i] + pa[i - 1]);
+        for (std::size_t i = 0; i + 1 < padded; ++i)
+            nb[i] = static_cast<std::uint16_t>(live[i] + pb[i + 1]);
+        nb[padded - 1] = live[padded - 1];
+    };
+
+    std::fill(a(-range - 2), a(-range - 2) + padded, 0);
+    std::fill(b(-range - 2), b(-range - 2) + padded, 0);
+    for (std::int64_t j = -range - 1; j <= range + 1; ++j)
+        diagonal_row(j);
+
+    // The diamond around row 0, one horizontal window per row: O(R) per cell
+    // once per step rather than per row.
+    std::uint16_t* d = counts_.data();
+    std::fill(counts_.begin(), counts_.end(), 0);
+    for (std::int64_t dy = -range; dy <= range; ++dy) {
+        const std::size_t w = r - static_cast<std::size_t>(dy < 0 ? -dy : dy);
+        std::uint16_t* p = live;
+        padded_row(dy, pad, p + 1);
+        p[0] = 0;
+        for (std::size_t i = 1; i <= padded; ++i)
+            p[i] = static_cast<std::uint16_t>(p[i] + p[i - 1]);
+        for (std::size_t x = 0; x < width_; ++x)
+            d[x] = static_cast<std::uint16_t>(d[x] + p[x + pad + w + 1] - p[x + pad - w]);
+    }
+
+    for (std::size_t y = 0; y < height_; ++y) {
+        update_row(y, d);
+        if (y + 1 == height_)
+            break;
+        const std::int64_t j = static_cast<std::int64_t>(y);
+        diagonal_row(j + range + 1);
+        // Gain the V below: the (+1, +1) arm from (x - R, y + 1) to
+        // (x, y + R + 1) and the (-1, +1) arm from (x + R, y + 1) to
+        // (x + 1, y + R). Lose the inverted V above: the (+1, +1) arm from
+        // (x + 1, y - R + 1) to (x + R, y) and the (-1, +1) arm from
+        // (x, y - R) to (x - R, y).
+        const std::uint16_t* a_low = a(j + range + 1);
+        const std::uint16_t* a_mid = a(j);
+        const std::uint16_t* a_high = a(j - range);
+        const std::uint16_t* b_low = b(j + range);
+        const std::uint16_t* b_mid = b(j);
+        const std::uint16_t* b_high = b(j - range - 1);
+        for (std::size_t x = 0; x < width_; ++x) {
+            const std::size_t i = x + pad;
+            const unsigned gain = a_low[i] - a_mid[i - r - 1] + b_low[i + 1] - b_mid[i + r + 1];
+            const unsigned loss = a_mid[i + r] - a_high[i] + b_mid[i - r] - b_high[i + 1];
+            d[x] = static_cast<std::uint16_t>(d[x] + gain - loss);
+        }
+    }
+}
+
+void LtlEngine::step()
+{
+    if (rule_.neighbourhood == LtlRule::Neighbourhood::moore)
+        step_moore();
+    else
+        step_von_neumann();
+    cells_.swap(next_);
+    ++generation_;
+}
+
+void LtlEngine::run(std::uint64_t generations)
+{
+    for (std::uint64_t g = 0; g < generations; ++g)
+        step();
+}
+
+std::uint64_t LtlEngine::population() const
+{
+    return static_cast<std::uint64_t>(std::count(cells_.begin(), cells_.end(), 1));
+}
+
+std::uint64_t LtlEngine::decaying() const
+{
+    return static_cast<std::uint64_t>(
+        std::count_if(cells_.begin(), cells_.end(), [](std::uint8_t s) { return s > 1; }));
+}
+
+void LtlEngine::write_rle(BufferedWriter& out) const
+{
+    std::size_t y0 = height_, y1 = 0, x0 = width_, x1 = 0;
+    for (std::size_t y = 0; y < height_; ++y) {
+        const std::uint8_t* row = cells_.data() + y * width_;
+        const auto first = std::find_if(row, row + width_, [](std::uint8_t s) { return s != 0; });
+        if (first == row + width_)
+            continue;
+        const auto last = std::find_if(std::make_reverse_iterator(row + width_),
+                                       std::make_reverse_iterator(row),
+                                       [](std::uint8_t s) { return s != 0; });
+        y0 = std::min(y0, y);
+        y1 = y + 1;
+        x0 = std::min(x0, static_cast<std::size_t>(first - row));
+        x1 = std::max(x1, static_cast<std::size_t>(last.base() - row));
+    }
+    if (y1 == 0)
+        y0 = x0 = 0;
+
+    RleWriter rle(out, static_cast<std::int64_t>(x1 - x0), static_cast<std::int64_t>(y1 - y0),
+                  rule_.to_string(), rule_.states);
+    for (std::size_t y = y0; y < y1; ++y) {
+        if (y != y0)
+            rle.next_row();
+        const std::uint8_t* row = cells_.data() + y * width_;
+        for (std::size_t x = x0; x < x1; ++x)
+            if (row[x])
+                rle.run(static_cast<std::int64_t>(x - x0), 1, row[x]);
+    }
+    rle.finish();
+}
+
+void LtlSink::live_run(std::int64_t x, std::int64_t y, std::int64_t length)
+{
+    state_run(x, y, length, 1);
+}
+
+void LtlSink::state_run(std::int64_t x, std::int64_t y, std::int64_t length, unsigned state)
+{
+    const std::size_t row = wrap(y + y0_, engine_.height());
+    length = std::min(length, static_cast<std::int64_t>(engine_.width()));
+    for (std::int64_t i = 0; i < length; ++i)
+        engine_.set_state(wrap(x + i + x0_, engine_.width()), row, state);
+}
+
+} // namespace conway
@@ -0,0 +1,128 @@
+#include "cli/commands.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace {
+
+void usage()
+{
+    std::fputs(
+        "usage: bash-conway [command] [options]\n"
+        "\n"
+        "commands:\n"
+        "  run     step a random soup and report throughput (default)\n"
+        "  bench   time the specialised, rule-table and decision-diagram rule kernels,\n"
+        "          then Larger than Life at ranges 1, 5 and 10, then snapshot save/load\n"
+        "  verify  check every stepping implementation against the reference stepper\n"
+        "  search  run many small random soups to stabilisation on every core\n"
+        "\n"
+        "run options:\n"
+        "  --width N       board width in cells, rounded up to a multiple of 64 (1024)\n"
+        "  --height N      board height in cells (1024)\n"
+        "  --gens N        generations to run; 2^K is accepted (1000)\n"
+        "  --density P     initial live-cell probability (0.5)\n"
+        "  --seed N        soup seed (1)\n"
+        "  --engine E      packed, generations or ltl (fixed torus), sparse or hashlife\n"
+        "                  (unbounded) (generations / ltl for those rules, else packed)\n"
+        "  --rule R        rule such as B3/S23, 23/3, Generations /2/3 or Larger than Life\n"
+        "                  R5,C0,M1,S34..58,B34..45,NM (pattern's rule, else B3/S23)\n"
+        "  --pattern FILE  start from an RLE, macrocell (.mc) or snapshot (.snap) file\n"
+        "                  instead of a soup\n"
+        "  --out FILE      write the final generation as RLE (macrocell if FILE ends in .mc,\n"
+        "                  binary snapshot of the packed board if it ends in .snap)\n"
+        "  --compress      store .snap tiles compressed where that is smaller\n"
+        "  --report-every N  print population and active tiles every N generations\n"
+        "  --period N      stop once the board repeats with period <= N and report it\n"
+        "                  (packed engine; 0: off) (0)\n"
+        "  --render        draw the middle of the board on the terminal from a separate\n"
+        "                  thread, sending only changed cells (packed engine)\n"
+        "  --screen CxR    render area in columns x rows, status line included\n"
+        "                  (terminal size)\n"
+        "  --fps N         frames per second drawn by --render (60)\n"
+        "  --glyphs G      cell, half (1x2 cells per character) or braille (2x4)\n"
+        "                  for --render (cell)\n"
+        "  --zoom N        render NxN cells as one, N a power of two, or fit to show\n"
+        "                  the whole board (1)\n"
+        "  --threads N     worker threads for the packed engine (1)\n"
+        "  --schedule S    packed engine: bands or steal (work-stealing tile spans) (bands)\n"
+        "  --no-skip       recompute every tile, even stable ones (packed)\n"
+        "  --hash-mem MB   hashlife node-table size that triggers garbage collection;\n"
+        "                  checked between and during steps, not a hard ceiling (1024)\n"
+        "  --kernel K      row kernel: auto, avx512, avx2 or scalar (auto; env CONWAY_KERNEL)\n"
+        "  --print-kernel  print the kernel that would run and exit\n"
+        "\n"
+        "bench options:\n"
+        "  --suite         run the fixed benchmark corpus instead (see below)\n"
+        "  --width N --height N --gens N --seed N --kernel K   as for run (2048, 2048, 200)\n"
+        "  --reps N        repetitions per measurement; the best is reported (3)\n"
+        "  --ltl-size N    side of the Larger than Life board (4096)\n"
+        "  --ltl-gens N    Larger than Life generations per measurement (20)\n"
+        "\n"
+        "bench --suite options (fixed corpus, median and p99 of each case):\n"
+        "  --patterns L    comma list of soup, r-pentomino, acorn, gun-array, max (all)\n"
+        "  --engines L     comma list of packed, packed-mt, sparse, hashlife (all)\n"
+        "  --sizes L       comma list of board sides (512,2048)\n"
+        "  --gens N --reps N --seed N --kernel K --hash-mem MB   (200, 9, 1, auto, 1024)\n"
+        "  --no-saves      skip the save and load timings of each packed board\n"
+        "  --out FILE      tab-separated results (bench_output.txt)\n"
+        "\n"
+        "verify options:\n"
+        "  --rule R        check only this rule (a fixed set of Life-like, non-totalistic,\n"
+        "                  Generations and Larger than Life rules)\n"
+        "  --size N        torus side, a multiple of 64 (256)\n"
+        "  --gens N        generations per start (128)\n"
+        "  --every N       generations between checkpoints (16)\n"
+        "  --soups N       random soups per rule (3)\n"
+        "  --seed N        first soup seed (1)\n"
+        "  --out FILE      per-case results (test_output.txt)\n"
+        "\n"
+        "search options:\n"
+        "  --soups N       soups to run (10000)\n"
+        "  --soup-size N   side of each soup, at most 64 (16)\n"
+        "  --seed N        search seed; soup i depends only on the seed and i (1)\n"
+        "  --rule R        Life-like or non-totalistic rule without B0 (B3/S23)\n"
+        "  --max-gens N    give up on a soup after N generations (20000)\n"
+        "  --max-period N  longest population period accepted as settled (60)\n"
+        "  --window N      generations the period must hold for (2 * max-period)\n"
+        "  --threads N     worker threads (all cores)\n"
+        "  --no-census     skip separating and naming the objects each soup left\n"
+        "  --top N         census entries to print, most common first (20)\n"
+        "  --out FILE      write the whole census, one name and count per line\n",
+        stderr);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int first = 1;
+    const char* command = "run";
+    if (argc > 1 && std::strncmp(argv[1], "--", 2) != 0) {
+        command = argv[1];
+        first = 2;
+    }
+    if (argc > 1 && (std::strcmp(argv[1], "--help") == 0 || std::strcmp(argv[1], "-h") == 0)) {
+        usage();
+        return 0;
+    }
+
+    try {
+        conway::cli::Args args(argc, argv, first);
+        if (std::strcmp(command, "run") == 0)
+            return conway::cli::run(args);
+        if (std::strcmp(command, "bench") == 0)
+            return conway::cli::bench(args);
+        if (std::strcmp(command, "verify") == 0)
+            return conway::cli::verify(args);
+        if (std::strcmp(command, "search") == 0)
+            return conway::cli::search(args);
+        std::fprintf(stderr, "bash-conway: unknown command '%s'\n", command);
+        usage();
+        return 2;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "bash-conway: %s\n", e.what());
+        return 2;
+    }
+}
@@ -0,0 +1,391 @@
+#include "conway/packed_engine.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace conway {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+} // namespace
+
+PackedEngine::PackedEngine(std::size_t width, std::size_t height, const Rule& rule,
+                           std::string_view kernel)
+    : rule_(rule)
+    , compiled_(rule)
+    , kernel_(select_kernel(kernel, rule))
+    , cur_(width, height)
+    , next_(width, height)
+    , tiles_x_(cur_.words_per_row())
+    , tiles_y_((height + kTileRows - 1) / kTileRows)
+    , changed_(tiles_x_ * tiles_y_, 1)
+    , active_(tiles_x_ * tiles_y_, 1)
+    , tile_rows_(tiles_x_ * tiles_y_)
+    , tile_cols_(tiles_x_ * tiles_y_)
+    , tile_pop_(tiles_x_ * tiles_y_)
+{
+    if (rule.generations())
+        throw std::runtime_error("Generations rules need the generations engine");
+    set_threads(1);
+}
+
+void PackedEngine::set_threads(std::size_t threads)
+{
+    threads = std::max<std::size_t>(1, std::min(threads, tiles_y_));
+    pool_ = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+    diffs_.assign(threads, std::vector<std::uint64_t>(cur_.words_per_row()));
+    stats_.assign(threads, {});
+    band_active_.assign(threads, 0);
+    band_delta_.assign(threads, {});
+    busy_before_.assign(threads, 0);
+    deques_ = std::make_unique<WorkStealingDeque<TileSpan>[]>(threads);
+}
+
+void PackedEngine::reset_worker_stats()
+{
+    std::fill(stats_.begin(), stats_.end(), WorkerStats{});
+}
+
+void PackedEngine::invalidate()
+{
+    std::fill(changed_.begin(), changed_.end(), 1);
+    summary_stale_ = true;
+}
+
+void PackedEngine::summarise(std::vector<std::uint64_t>& rows, std::vector<std::uint64_t>& cols) const
+{
+    const std::size_t h = cur_.height();
+    rows.assign(tiles_x_ * tiles_y_, 0);
+    cols.assign(tiles_x_ * tiles_y_, 0);
+    for (std::size_t y = 0; y < h; ++y) {
+        const std::uint64_t* row = cur_.row(y);
+        const std::size_t t = (y / kTileRows) * tiles_x_;
+        const std::uint64_t bit = std::uint64_t{1} << (y % kTileRows);
+        for (std::size_t x = 0; x < tiles_x_; ++x) {
+            cols[t + x] |= row[x];
+            rows[t + x] |= row[x] ? bit : 0;
+        }
+    }
+}
+
+std::uint64_t PackedEngine::scan_hash() const
+{
+    const std::size_t words = cur_.words_per_row();
+    std::uint64_t h = 0;
+    for (std::size_t y = 0; y < cur_.height(); ++y) {
+        const std::uint64_t* row = cur_.row(y);
+        for (std::size_t x = 0; x < words; ++x)
+            h += word_hash(y * words + x, row[x]);
+    }
+    return h;
+}
+
+std::uint32_t PackedEngine::tile_population(std::size_t tx, std::size_t ty) const
+{
+    if (!summary_stale_)
+        return tile_pop_[ty * tiles_x_ + tx];
+    const std::size_t y1 = std::min(cur_.height(), (ty + 1) * kTileRows);
+    std::uint32_t n = 0;
+    for (std::size_t y = ty * kTileRows; y < y1; ++y)
+        n += static_cast<std::uint32_t>(std::popcount(cur_.row(y)[tx]));
+    return n;
+}
+
+void PackedEngine::rebuild_summary()
+{
+    summarise(tile_rows_, tile_cols_);
+    std::fill(tile_pop_.begin(), tile_pop_.end(), 0);
+    for (std::size_t y = 0; y < cur_.height(); ++y) {
+        const std::uint64_t* row = cur_.row(y);
+        std::uint32_t* pop = &tile_pop_[(y / kTileRows) * tiles_x_];
+        for (std::size_t x = 0; x < tiles_x_; ++x)
+            pop[x] += static_cast<std::uint32_t>(std::popcount(row[x]));
+    }
+    population_ = cur_.population();
+    hash_ = scan_hash();
+    box_ = fold_box(tile_rows_, tile_cols_);
+    summary_stale_ = false;
+}
+
+PackedEngine::Box PackedEngine::fold_box(const std::vector<std::uint64_t>& tile_rows,
+                                         const std::vector<std::uint64_t>& tile_cols) const
+{
+    // One pass over the tile masks, 1/kTileRows of the board's words.
+    Box box;
+    std::int64_t x0 = INT64_MAX, x1 = 0, y0 = INT64_MAX, y1 = 0;
+    for (std::size_t ty = 0; ty < tiles_y_; ++ty) {
+        const std::uint64_t* rows = &tile_rows[ty * tiles_x_];
+        const std::uint64_t* cols = &tile_cols[ty * tiles_x_];
+        std::uint64_t any_row = 0;
+        for (std::size_t tx = 0; tx < tiles_x_; ++tx) {
+            any_row |= rows[tx];
+            if (!cols[tx])
+                continue;
+            const auto base = static_cast<std::int64_t>(tx * 64);
+            x0 = std::min(x0, base + std::countr_zero(cols[tx]));
+            x1 = std::max(x1, base + 64 - std::countl_zero(cols[tx]));
+        }
+        if (!any_row)
+            continue;
+        const auto base = static_cast<std::int64_t>(ty * kTileRows);
+        y0 = std::min(y0, base + std::countr_zero(any_row));
+        y1 = base + 64 - std::countl_zero(any_row);
+    }
+    if (y1 > 0)
+        box = {x0, y0, x1, y1};
+    return box;
+}
+
+std::uint64_t PackedEngine::population() const
+{
+    return summary_stale_ ? cur_.population() : population_;
+}
+
+std::uint64_t PackedEngine::hash() const
+{
+    return summary_stale_ ? scan_hash() : hash_;
+}
+
+bool PackedEngine::bounds(std::int64_t& x0, std::int64_t& y0, std::int64_t& x1, std::int64_t& y1) const
+{
+    Box box = box_;
+    if (summary_stale_) {
+        // Edited since the last step: summarise the board itself.
+        std::vector<std::uint64_t> rows, cols;
+        summarise(rows, cols);
+        box = fold_box(rows, cols);
+    }
+    x0 = box.x0;
+    y0 = box.y0;
+    x1 = box.x1;
+    y1 = box.y1;
+    return y1 > y0;
+}
+
+void PackedEngine::mark_active()
+{
+    if (!skip_tiles_) {
+        std::fill(active_.begin(), active_.end(), 1);
+        return;
+    }
+    for (std::size_t ty = 0; ty < tiles_y_; ++ty) {
+        const std::uint8_t* rows[3] = {
+            &changed_[(ty == 0 ? tiles_y_ - 1 : ty - 1) * tiles_x_],
+            &changed_[ty * tiles_x_],
+            &changed_[(ty + 1 == tiles_y_ ? 0 : ty + 1) * tiles_x_],
+        };
+        for (std::size_t tx = 0; tx < tiles_x_; ++tx) {
+            const std::size_t l = tx == 0 ? tiles_x_ - 1 : tx - 1;
+            const std::size_t r = tx + 1 == tiles_x_ ? 0 : tx + 1;
+            std::uint8_t any = 0;
+            for (const std::uint8_t* row : rows)
+                any |= row[l] | row[tx] | row[r];
+            active_[ty * tiles_x_ + tx] = any;
+        }
+    }
+}
+
+PackedEngine::Delta PackedEngine::step_span(std::size_t ty, std::size_t tx0, std::size_t tx1,
+                                            std::uint64_t* diff)
+{
+    const std::size_t h = cur_.height();
+    const std::size_t words = cur_.words_per_row();
+    const std::size_t y0 = ty * kTileRows;
+    const std::size_t y1 = std::min(h, y0 + kTileRows);
+    std::uint64_t* rows = &tile_rows_[ty * tiles_x_];
+    std::uint64_t* cols = &tile_cols_[ty * tiles_x_];
+    std::uint32_t* pops = &tile_pop_[ty * tiles_x_];
+    std::fill(diff, diff + (tx1 - tx0), 0);
+    std::fill(rows + tx0, rows + tx1, 0);
+    std::fill(cols + tx0, cols + tx1, 0);
+    std::fill(pops + tx0, pops + tx1, 0);
+    // Population and occupancy ride along with the change mask: the words
+    // are in registers anyway, so this costs two popcounts and a few ORs,
+    // plus two word hashes for each word that actually changed.
+    Delta delta;
+    for (std::size_t y = y0; y < y1; ++y) {
+        const std::uint64_t* up = cur_.row(y == 0 ? h - 1 : y - 1);
+        const std::uint64_t* mid = cur_.row(y);
+        const std::uint64_t* down = cur_.row(y + 1 == h ? 0 : y + 1);
+        std::uint64_t* out = next_.row(y);
+        kernel_.fn(up, mid, down, out, words, tx0, tx1, compiled_);
+        const std::uint64_t bit = std::uint64_t{1} << (y - y0);
+        for (std::size_t x = tx0; x < tx1; ++x) {
+            const int live = std::popcount(out[x]);
+            diff[x - tx0] |= out[x] ^ mid[x];
+            delta.population += live - std::popcount(mid[x]);
+            pops[x] += static_cast<std::uint32_t>(live);
+            if (out[x] != mid[x])
+                delta.hash += word_hash(y * words + x, out[x]) - word_hash(y * words + x, mid[x]);
+            cols[x] |= out[x];
+            rows[x] |= out[x] ? bit : 0;
+        }
+    }
+    std::uint8_t* changed = &changed_[ty * tiles_x_];
+    for (std::size_t x = tx0; x < tx1; ++x)
+        changed[x] = diff[x - tx0] != 0;
+    return delta;
+}
+
+std::size_t PackedEngine::step_tile_rows(std::size_t ty0, std::size_t ty1,
+                                         std::vector<std::uint64_t>& diff, Delta& delta)
+{
+    std::size_t active = 0;
+    delta = {};
+    for (std::size_t ty = ty0; ty < ty1; ++ty) {
+        const std::uint8_t* act = &active_[ty * tiles_x_];
+        std::uint8_t* changed = &changed_[ty * tiles_x_];
+        std::size_t tx = 0;
+        while (tx < tiles_x_) {
+            if (!act[tx]) {
+                changed[tx] = 0;
+                ++tx;
+                continue;
+            }
+            // Step a whole run of adjacent active tiles at once so the SIMD
+            // kernels see contiguous words.
+            const std::size_t a = tx;
+            while (tx < tiles_x_ && act[tx])
+                ++tx;
+            active += tx - a;
+            delta += step_span(ty, a, tx, diff.data());
+        }
+    }
+    return active;
+}
+
+void PackedEngine::run_bands()
+{
+    const std::size_t bands = stats_.size();
+    auto band = [this, bands](std::size_t i) {
+        const auto start = Clock::now();
+        const std::size_t ty0 = tiles_y_ * i / bands;
+        const std::size_t ty1 = tiles_y_ * (i + 1) / bands;
+        band_active_[i] = step_tile_rows(ty0, ty1, diffs_[i], band_delta_[i]);
+        stats_[i].busy_seconds += seconds(Clock::now() - start);
+    };
+    if (pool_)
+        pool_->run(band);
+    else
+        band(0);
+}
+
+void PackedEngine::run_stealing()
+{
+    // Deal spans of active tiles to the worker that owns their band, so an
+    // evenly busy board keeps the locality of banded stepping and only
+    // imbalance causes steals.
+    const std::size_t workers = stats_.size();
+    std::size_t total = 0;
+    for (std::size_t w = 0; w < workers; ++w) {
+        const std::size_t ty0 = tiles_y_ * w / workers;
+        const std::size_t ty1 = tiles_y_ * (w + 1) / workers;
+        deques_[w].reset((ty1 - ty0) * tiles_x_);
+        for (std::size_t ty = ty0; ty < ty1; ++ty) {
+            const std::uint8_t* act = &active_[ty * tiles_x_];
+            std::uint8_t* changed = &changed_[ty * tiles_x_];
+            std::size_t tx = 0;
+            while (tx < tiles_x_) {
+                if (!act[tx]) {
+                    changed[tx] = 0;
+                    ++tx;
+                    continue;
+                }
+                const std::size_t a = tx;
+                while (tx < tiles_x_ && act[tx] && tx - a < kSpanTiles)
+                    ++tx;
+                deques_[w].push({static_cast<std::uint32_t>(ty), static_cast<std::uint32_t>(a),
+                                 static_cast<std::uint32_t>(tx)});
+                ++total;
+            }
+        }
+    }
+    spans_left_.store(total, std::memory_order_relaxed);
+    auto job = [this](std::size_t i) { steal_worker(i); };
+    if (pool_)
+        pool_->run(job);
+    else
+        job(0);
+}
+
+void PackedEngine::steal_worker(std::size_t index)
+{
+    const std::size_t workers = stats_.size();
+    WorkerStats& stats = stats_[index];
+    std::uint64_t diff[kSpanTiles];
+    std::size_t tiles = 0;
+    Delta delta;
+    std::size_t victim = index;
+    TileSpan span;
+    while (spans_left_.load(std::memory_order_acquire) > 0) {
+        bool got = deques_[index].pop(span);
+        if (!got && workers > 1) {
+            victim = victim + 1 == workers ? 0 : victim + 1;
+            if (victim != index) {
+                got = deques_[victim].steal(span);
+                stats.steals += got;
+            }
+        }
+        if (!got) {
+            // Every victim visited without luck: the last spans are in
+            // flight elsewhere, so give the core away instead of spinning.
+            if (victim == index || workers == 1)
+                std::this_thread::yield();
+            continue;
+        }
+        const auto start = Clock::now();
+        delta += step_span(span.ty, span.tx0, span.tx1, diff);
+        stats.busy_seconds += seconds(Clock::now() - start);
+        tiles += span.tx1 - span.tx0;
+        spans_left_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    band_active_[index] = tiles;
+    band_delta_[index] = delta;
+}
+
+void PackedEngine::step()
+{
+    const auto start = Clock::now();
+    if (summary_stale_)
+        rebuild_summary();
+    mark_active();
+    for (std::size_t i = 0; i < stats_.size(); ++i)
+        busy_before_[i] = stats_[i].busy_seconds;
+
+    if (schedule_ == Schedule::steal)
+        run_stealing();
+    else
+        run_bands();
+
+    const double wall = seconds(Clock::now() - start);
+    active_tiles_ = 0;
+    for (std::size_t i = 0; i < stats_.size(); ++i) {
+        active_tiles_ += band_active_[i];
+        stats_[i].tiles += band_active_[i];
+        stats_[i].idle_seconds += std::max(0.0, wall - (stats_[i].busy_seconds - busy_before_[i]));
+        population_ = static_cast<std::uint64_t>(static_cast<std::int64_t>(population_)
+                                                 + band_delta_[i].population);
+        hash_ += band_delta_[i].hash;
+    }
+    box_ = fold_box(tile_rows_, tile_cols_);
+    swap(cur_, next_);
+    ++generation_;
+}
+
+void PackedEngine::run(std::uint64_t generations)
+{
+    for (std::uint64_t g = 0; g < generations; ++g)
+        step();
+}
+
+} // namespace conway
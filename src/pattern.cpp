@@ -0,0 +1,440 @@
+#include "conway/pattern.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace conway {
+
+namespace {
+
+std::int64_t wrap(std::int64_t v, std::int64_t n)
+{
+    v %= n;
+    return v < 0 ? v + n : v;
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front())))
+        s.remove_prefix(1);
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back())))
+        s.remove_suffix(1);
+    return s;
+}
+
+/// Reads "key = value" pairs from an RLE header line.
+void parse_header(std::string_view line, PatternInfo& info)
+{
+    std::size_t pos = 0;
+    while (pos < line.size()) {
+        std::size_t comma = line.find(',', pos);
+        if (comma == std::string_view::npos)
+            comma = line.size();
+        std::string_view item = line.substr(pos, comma - pos);
+        const std::size_t eq = item.find('=');
+        if (eq == std::string_view::npos) {
+            pos = comma + 1;
+            continue;
+        }
+        const std::string_view key = trim(item.substr(0, eq));
+        // Larger than Life rules contain commas themselves; the rule is the
+        // last field.
+        if (key == "rule")
+            item = line.substr(pos);
+        pos = comma + 1;
+        const std::string_view value = trim(item.substr(eq + 1));
+        if (key == "x")
+            info.width = std::stoll(std::string(value));
+        else if (key == "y")
+            info.height = std::stoll(std::string(value));
+        else if (key == "rule")
+            info.rule = std::string(value);
+    }
+}
+
+/// Consumes the comment and header lines of an RLE file; returns the offset
+/// of the first body character.
+std::size_t parse_rle_header(std::string_view text, PatternInfo& info)
+{
+    std::size_t pos = 0;
+    bool header_seen = false;
+    while (pos < text.size()) {
+        std::size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos)
+            eol = text.size();
+        const std::string_view line = text.substr(pos, eol - pos);
+        std::size_t first = 0;
+        while (first < line.size() && std::isspace(static_cast<unsigned char>(line[first])))
+            ++first;
+        if (first == line.size() || line[first] == '#') {
+            pos = eol + 1;
+            continue;
+        }
+        if (!header_seen && line[first] == 'x') {
+            parse_header(line, info);
+            header_seen = true;
+            pos = eol + 1;
+            continue;
+        }
+        break;
+    }
+    return pos;
+}
+
+} // namespace
+
+PatternInfo read_pattern_info(std::string_view text)
+{
+    PatternInfo info;
+    if (!is_macrocell(text)) {
+        parse_rle_header(text, info);
+        return info;
+    }
+    std::size_t pos = 0;
+    while (pos < text.size() && (text[pos] == '#' || text[pos] == '[')) {
+        std::size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos)
+            eol = text.size();
+        std::string_view line = text.substr(pos, eol - pos);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        const std::string_view value = trim(line.substr(std::min<std::size_t>(2, line.size())));
+        if (line.substr(0, 2) == "#R")
+            info.rule = std::string(value);
+        else if (line.substr(0, 2) == "#G" && !value.empty())
+            info.generation = std::stoull(std::string(value));
+        pos = eol + 1;
+    }
+    return info;
+}
+
+PatternInfo read_rle(std::string_view text, CellSink& sink)
+{
+    PatternInfo info;
+    std::size_t pos = parse_rle_header(text, info);
+
+    std::int64_t x = 0;
+    std::int64_t y = 0;
+    std::int64_t count = 0;
+    // Hot loop: walk the mapped bytes directly and hand whole runs to the
+    // sink, which can set them a word at a time.
+    const char* p = text.data() + std::min(pos, text.size());
+    const char* const end = text.data() + text.size();
+    for (; p < end; ++p) {
+        const char ch = *p;
+        if (static_cast<unsigned>(ch - '0') < 10u) {
+            count = count * 10 + (ch - '0');
+            continue;
+        }
+        switch (ch) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            continue;
+        case 'b':
+        case '.':
+            x += count == 0 ? 1 : count;
+            break;
+        case '$':
+            y += count == 0 ? 1 : count;
+            x = 0;
+            break;
+        case '!':
+            return info;
+        default: {
+            if (!std::isalpha(static_cast<unsigned char>(ch)))
+                throw std::runtime_error(std::string("unexpected character '") + ch + "' in RLE");
+            const std::int64_t n = count == 0 ? 1 : count;
+            // Multistate files spell states as A-X, or pA-yO above 24; any
+            // other letter is a live cell of a two-state pattern.
+            unsigned state = 1;
+            if (ch >= 'A' && ch <= 'X') {
+                state = static_cast<unsigned>(ch - 'A') + 1;
+            } else if (ch >= 'p' && ch <= 'y' && p + 1 < end && p[1] >= 'A' && p[1] <= 'X') {
+                state = 24 * static_cast<unsigned>(ch - 'p' + 1) + static_cast<unsigned>(p[1] - 'A') + 1;
+                ++p;
+            }
+            if (state == 1)
+                sink.live_run(x, y, n);
+            else
+                sink.state_run(x, y, n, state);
+            x += n;
+            break;
+        }
+        }
+        count = 0;
+    }
+    return info;
+}
+
+bool is_macrocell(std::string_view text)
+{
+    return text.substr(0, 4) == "[M2]";
+}
+
+PatternInfo parse_macrocell(std::string_view text, std::vector<MacrocellNode>& nodes)
+{
+    PatternInfo info = read_pattern_info(text);
+    nodes.assign(1, MacrocellNode{0, 0, 0, 0, 0, 0});
+
+    const char* p = text.data();
+    const char* const end = p + text.size();
+    auto number = [&]() {
+        while (p < end && *p == ' ')
+            ++p;
+        if (p == end || *p < '0' || *p > '9')
+            throw std::runtime_error("malformed macrocell node line");
+        std::uint64_t v = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+            v = v * 10 + static_cast<std::uint64_t>(*p++ - '0');
+        return v;
+    };
+
+    while (p < end) {
+        const char ch = *p;
+        if (ch == '#' || ch == '[' || ch == '\n' || ch == '\r') {
+            const void* eol = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+            p = eol ? static_cast<const char*>(eol) + 1 : end;
+            continue;
+        }
+        MacrocellNode node{};
+        if (ch == '.' || ch == '*' || ch == '$') {
+            // 8x8 leaf: rows of '.'/'*' each terminated by '$'.
+            node.level = 3;
+            unsigned x = 0, y = 0;
+            for (; p < end && *p != '\n'; ++p) {
+                if (*p == '$') {
+                    x = 0;
+                    ++y;
+                } else if (*p == '*') {
+                    if (x >= 8 || y >= 8)
+                        throw std::runtime_error("macrocell leaf exceeds 8x8");
+                    node.leaf |= std::uint64_t{1} << (y * 8 + x++);
+                } else if (*p == '.') {
+                    ++x;
+                } else if (*p != '\r') {
+                    throw std::runtime_error("malformed macrocell leaf line");
+                }
+            }
+        } else {
+            node.level = static_cast<std::uint32_t>(number());
+            std::uint32_t* kids[4] = {&node.nw, &node.ne, &node.sw, &node.se};
+            for (std::uint32_t* k : kids) {
+                const std::uint64_t id = number();
+                if (id >= nodes.size())
+                    throw std::runtime_error("macrocell node refers forward");
+                if (id != 0 && nodes[id].level + 1 != node.level)
+                    throw std::runtime_error("macrocell node level mismatch");
+                *k = static_cast<std::uint32_t>(id);
+            }
+            if (node.level <= 3)
+                throw std::runtime_error("multi-state macrocell files are not supported");
+            while (p < end && *p != '\n')
+                ++p;
+        }
+        nodes.push_back(node);
+    }
+    if (nodes.size() < 2)
+        throw std::runtime_error("macrocell file has no nodes");
+    info.width = info.height = std::int64_t{1} << nodes.back().level;
+    return info;
+}
+
+void emit_macrocell(const std::vector<MacrocellNode>& nodes, CellSink& sink)
+{
+    struct Item {
+        std::uint32_t id;
+        std::int64_t x, y;
+    };
+    std::vector<Item> stack{{static_cast<std::uint32_t>(nodes.size() - 1), 0, 0}};
+    while (!stack.empty()) {
+        const Item it = stack.back();
+        stack.pop_back();
+        if (it.id == 0)
+            continue;
+        const MacrocellNode& n = nodes[it.id];
+        if (n.level == 3) {
+            for (int y = 0; y < 8; ++y) {
+                std::uint64_t row = (n.leaf >> (y * 8)) & 0xffu;
+                while (row) {
+                    const int start = std::countr_zero(row);
+                    const int len = std::countr_one(row >> start);
+                    sink.live_run(it.x + start, it.y + y, len);
+                    row &= ~(((std::uint64_t{1} << len) - 1) << start);
+                }
+            }
+            continue;
+        }
+        const std::int64_t h = std::int64_t{1} << (n.level - 1);
+        stack.push_back({n.se, it.x + h, it.y + h});
+        stack.push_back({n.sw, it.x, it.y + h});
+        stack.push_back({n.ne, it.x + h, it.y});
+        stack.push_back({n.nw, it.x, it.y});
+    }
+}
+
+RleWriter::RleWriter(BufferedWriter& out, std::int64_t width, std::int64_t height, const Rule& rule)
+    : RleWriter(out, width, height, rule.to_string(), rule.states)
+{
+}
+
+RleWriter::RleWriter(BufferedWriter& out, std::int64_t width, std::int64_t height, std::string_view rule,
+                     unsigned states)
+    : out_(out)
+    , multistate_(states > 2)
+{
+    out_.write("x = ");
+    out_.write_uint(static_cast<std::uint64_t>(width));
+    out_.write(", y = ");
+    out_.write_uint(static_cast<std::uint64_t>(height));
+    out_.write(", rule = ");
+    out_.write(rule);
+    out_.put('\n');
+}
+
+void RleWriter::emit(std::int64_t count, std::string_view tag)
+{
+    if (count <= 0)
+        return;
+    char digits[24];
+    std::size_t n = 0;
+    if (count > 1) {
+        const auto r = std::to_chars(digits, digits + sizeof digits, count);
+        n = static_cast<std::size_t>(r.ptr - digits);
+    }
+    if (column_ + n + tag.size() > 70) {
+        out_.put('\n');
+        column_ = 0;
+    }
+    out_.write(std::string_view(digits, n));
+    out_.write(tag);
+    column_ += n + tag.size();
+}
+
+void RleWriter::flush_run()
+{
+    if (run_length_ == 0)
+        return;
+    emit(pending_rows_, "$");
+    pending_rows_ = 0;
+    if (!multistate_) {
+        emit(run_start_ - x_, "b");
+        emit(run_length_, "o");
+    } else {
+        // Golly's multistate alphabet: '.', then A-X, then pA-pX ... yA-yO.
+        emit(run_start_ - x_, ".");
+        char token[2];
+        std::size_t n = 0;
+        if (run_state_ > 24)
+            token[n++] = static_cast<char>('p' + (run_state_ - 25) / 24);
+        token[n++] = static_cast<char>('A' + (run_state_ - 1) % 24);
+        emit(run_length_, std::string_view(token, n));
+    }
+    x_ = run_start_ + run_length_;
+    run_length_ = 0;
+}
+
+void RleWriter::live(std::int64_t x, std::int64_t length)
+{
+    run(x, length, 1);
+}
+
+void RleWriter::run(std::int64_t x, std::int64_t length, unsigned state)
+{
+    if (length <= 0)
+        return;
+    if (run_length_ > 0 && run_start_ + run_length_ == x && run_state_ == state) {
+        run_length_ += length;
+        return;
+    }
+    flush_run();
+    run_start_ = x;
+    run_length_ = length;
+    run_state_ = state;
+}
+
+void RleWriter::next_row(std::int64_t rows)
+{
+    flush_run();
+    pending_rows_ += rows;
+    x_ = 0;
+}
+
+void RleWriter::finish()
+{
+    flush_run();
+    out_.put('!');
+    out_.put('\n');
+}
+
+void write_rle(BufferedWriter& out, const Grid& grid, const Rule& rule)
+{
+    const std::size_t words = grid.words_per_row();
+    std::size_t y0 = grid.height(), y1 = 0, x0 = grid.width(), x1 = 0;
+    for (std::size_t y = 0; y < grid.height(); ++y) {
+        const std::uint64_t* row = grid.row(y);
+        std::size_t first = 0;
+        while (first < words && !row[first])
+            ++first;
+        if (first == words)
+            continue;
+        std::size_t last = words - 1;
+        while (!row[last])
+            --last;
+        y0 = std::min(y0, y);
+        y1 = y + 1;
+        x0 = std::min(x0, first * 64 + static_cast<std::size_t>(std::countr_zero(row[first])));
+        x1 = std::max(x1, last * 64 + 64 - static_cast<std::size_t>(std::countl_zero(row[last])));
+    }
+    if (y0 >= y1)
+        x0 = x1 = y0 = y1 = 0;
+
+    RleWriter rle(out, static_cast<std::int64_t>(x1 - x0), static_cast<std::int64_t>(y1 - y0), rule);
+    for (std::size_t y = y0; y < y1; ++y) {
+        if (y != y0)
+            rle.next_row();
+        const std::uint64_t* row = grid.row(y);
+        for (std::size_t i = x0 / 64; i * 64 < x1; ++i) {
+            std::uint64_t w = row[i];
+            while (w) {
+                const int start = std::countr_zero(w);
+                const int len = std::countr_one(w >> start);
+                rle.live(static_cast<std::int64_t>(i * 64 + static_cast<std::size_t>(start) - x0), len);
+                w = len == 64 ? 0 : w & ~(((std::uint64_t{1} << len) - 1) << start);
+            }
+        }
+    }
+    rle.finish();
+}
+
+void GridSink::live_run(std::int64_t x, std::int64_t y, std::int64_t length)
+{
+    const std::int64_t w = static_cast<std::int64_t>(grid_.width());
+    const std::int64_t h = static_cast<std::int64_t>(grid_.height());
+    std::int64_t cy = y0_ + y;
+    std::int64_t cx = x0_ + x;
+    if (cy < 0 || cy >= h)
+        cy = wrap(cy, h);
+    if (cx < 0 || cx >= w)
+        cx = wrap(cx, w);
+    std::uint64_t* row = grid_.row(static_cast<std::size_t>(cy));
+    length = std::min(length, w);
+    while (length > 0) {
+        // Set bits word by word rather than cell by cell.
+        const std::int64_t bit = cx & 63;
+        const std::int64_t n = std::min({length, 64 - bit, w - cx});
+        const std::uint64_t mask = (n == 64 ? ~std::uint64_t{0} : ((std::uint64_t{1} << n) - 1)) << bit;
+        row[cx >> 6] |= mask;
+        length -= n;
+        cx += n;
+        if (cx == w)
+            cx = 0;
+    }
+}
+
+} // namespace conway
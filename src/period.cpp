@@ -0,0 +1,63 @@
+#include "conway/period.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace conway {
+
+PeriodDetector::PeriodDetector(std::size_t max_period) : ring_(max_period)
+{
+    if (max_period == 0)
+        throw std::runtime_error("period detection needs a maximum period of at least 1");
+}
+
+std::size_t PeriodDetector::observe(std::uint64_t hash, std::uint64_t population)
+{
+    const std::size_t n = ring_.size();
+    std::size_t found = 0;
+    for (std::size_t p = 1; p <= count_; ++p) {
+        const Entry& e = ring_[(head_ + n - p) % n];
+        if (e.hash == hash && e.population == population) {
+            found = p;
+            break;
+        }
+    }
+    ring_[head_] = {hash, population};
+    head_ = head_ + 1 == n ? 0 : head_ + 1;
+    if (count_ < n)
+        ++count_;
+    return found;
+}
+
+PopulationPeriod::PopulationPeriod(std::size_t max_period, std::size_t window)
+    : window_(window), history_(max_period + 1), runs_(max_period)
+{
+    if (max_period == 0 || window == 0)
+        throw std::runtime_error("population periodicity needs a maximum period and window of at least 1");
+}
+
+std::size_t PopulationPeriod::observe(std::uint64_t population)
+{
+    const std::size_t n = history_.size();
+    std::size_t found = 0;
+    for (std::size_t p = 1; p < n; ++p) {
+        const bool match = p <= count_ && history_[(head_ + n - p) % n] == population;
+        runs_[p - 1] = match ? runs_[p - 1] + 1 : 0;
+        if (!found && runs_[p - 1] >= window_)
+            found = p;
+    }
+    history_[head_] = population;
+    head_ = head_ + 1 == n ? 0 : head_ + 1;
+    if (count_ < n)
+        ++count_;
+    return found;
+}
+
+void PopulationPeriod::reset()
+{
+    head_ = 0;
+    count_ = 0;
+    std::fill(runs_.begin(), runs_.end(), 0);
+}
+
+} // namespace conway
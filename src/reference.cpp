@@ -0,0 +1,160 @@
+#include "conway/reference.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace conway {
+
+namespace {
+
+std::size_t wrap(std::int64_t v, std::size_t n)
+{
+    const auto m = static_cast<std::int64_t>(n);
+    v %= m;
+    return static_cast<std::size_t>(v < 0 ? v + m : v);
+}
+
+} // namespace
+
+std::uint64_t cell_hash(std::int64_t x, std::int64_t y, unsigned state)
+{
+    // SplitMix64 finaliser over the packed coordinates and state.
+    std::uint64_t z = (static_cast<std::uint64_t>(x) * 0x9e3779b97f4a7c15ull)
+        ^ (static_cast<std::uint64_t>(y) * 0xc2b2ae3d27d4eb4full) ^ (std::uint64_t{state} << 56);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+ReferenceEngine::ReferenceEngine(std::size_t width, std::size_t height, const Rule& rule)
+    : width_(width)
+    , height_(height)
+    , rule_(rule)
+    , states_(rule.states)
+    , cells_(width * height)
+{
+}
+
+ReferenceEngine::ReferenceEngine(std::size_t width, std::size_t height, const LtlRule& rule)
+    : width_(width)
+    , height_(height)
+    , ltl_(rule)
+    , states_(rule.states)
+    , cells_(width * height)
+{
+}
+
+void ReferenceEngine::set_state(std::size_t x, std::size_t y, unsigned state)
+{
+    if (state >= states_)
+        throw std::runtime_error("state out of range");
+    cells_[y * width_ + x] = static_cast<std::uint8_t>(state);
+}
+
+unsigned ReferenceEngine::next_state(std::size_t x, std::size_t y) const
+{
+    const unsigned s = state(x, y);
+    if (s >= 2)
+        return s + 1 == states_ ? 0 : s + 1;
+
+    bool alive_next;
+    if (ltl_) {
+        const int r = static_cast<int>(ltl_->range);
+        unsigned count = 0;
+        for (int dy = -r; dy <= r; ++dy)
+            for (int dx = -r; dx <= r; ++dx) {
+                if (ltl_->neighbourhood == LtlRule::Neighbourhood::von_neumann
+                    && std::abs(dx) + std::abs(dy) > r)
+                    continue;
+                if (dx == 0 && dy == 0 && !ltl_->middle)
+                    continue;
+                count += state(wrap(static_cast<std::int64_t>(x) + dx, width_),
+                               wrap(static_cast<std::int64_t>(y) + dy, height_)) == 1;
+            }
+        alive_next = s == 1 ? count >= ltl_->survive_min && count <= ltl_->survive_max
+                            : count >= ltl_->birth_min && count <= ltl_->birth_max;
+    } else {
+        std::uint32_t n = 0;
+        for (int dy = -1; dy <= 1; ++dy)
+            for (int dx = -1; dx <= 1; ++dx)
+                if (state(wrap(static_cast<std::int64_t>(x) + dx, width_),
+                          wrap(static_cast<std::int64_t>(y) + dy, height_)) == 1)
+                    n |= 1u << (3 * (dy + 1) + (dx + 1));
+        alive_next = rule_.next_state(n);
+    }
+    if (s == 0)
+        return alive_next ? 1 : 0;
+    return alive_next ? 1 : states_ > 2 ? 2 : 0;
+}
+
+void ReferenceEngine::step()
+{
+    std::vector<std::uint8_t> next(cells_.size());
+    for (std::size_t y = 0; y < height_; ++y)
+        for (std::size_t x = 0; x < width_; ++x)
+            next[y * width_ + x] = static_cast<std::uint8_t>(next_state(x, y));
+    cells_.swap(next);
+    ++generation_;
+}
+
+void ReferenceEngine::run(std::uint64_t generations)
+{
+    for (std::uint64_t g = 0; g < generations; ++g)
+        step();
+}
+
+std::uint64_t ReferenceEngine::population() const
+{
+    std::uint64_t total = 0;
+    for (std::uint8_t s : cells_)
+        total += s == 1;
+    return total;
+}
+
+std::uint64_t ReferenceEngine::hash() const
+{
+    std::uint64_t h = 0;
+    for (std::size_t y = 0; y < height_; ++y)
+        for (std::size_t x = 0; x < width_; ++x)
+            if (const unsigned s = state(x, y))
+                h += cell_hash(static_cast<std::int64_t>(x), static_cast<std::int64_t>(y), s);
+    return h;
+}
+
+bool ReferenceEngine::bounds(std::int64_t& x0, std::int64_t& y0, std::int64_t& x1, std::int64_t& y1) const
+{
+    x0 = y0 = INT64_MAX;
+    x1 = y1 = 0;
+    for (std::size_t y = 0; y < height_; ++y)
+        for (std::size_t x = 0; x < width_; ++x)
+            if (state(x, y) == 1) {
+                x0 = std::min(x0, static_cast<std::int64_t>(x));
+                y0 = std::min(y0, static_cast<std::int64_t>(y));
+                x1 = std::max(x1, static_cast<std::int64_t>(x) + 1);
+                y1 = std::max(y1, static_cast<std::int64_t>(y) + 1);
+            }
+    if (y1 == 0) {
+        x0 = y0 = 0;
+        return false;
+    }
+    return true;
+}
+
+bool ReferenceEngine::near_edge(std::size_t margin) const
+{
+    for (std::size_t y = 0; y < height_; ++y)
+        for (std::size_t x = 0; x < width_; ++x)
+            if (state(x, y) && (x < margin || y < margin || x + margin >= width_ || y + margin >= height_))
+                return true;
+    return false;
+}
+
+void ReferenceSink::state_run(std::int64_t x, std::int64_t y, std::int64_t length, unsigned state)
+{
+    const std::size_t row = wrap(y + y0_, engine_.height());
+    for (std::int64_t i = 0; i < length; ++i)
+        engine_.set_state(wrap(x + i + x0_, engine_.width()), row, state);
+}
+
+} // namespace conway
@@ -0,0 +1,262 @@
+#include "conway/rule.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+namespace conway {
+
+namespace {
+
+/// Hensel letters in canonical order. Count k (or 8 - k) uses the first
+/// kLetterCount[k] of them.
+constexpr std::string_view kLetters = "cekainyqjrtwz";
+constexpr unsigned kLetterCount[9] = {0, 2, 6, 10, 13, 10, 6, 2, 0};
+
+/// Neighbours in ring order N, NE, E, SE, S, SW, W, NW, as bits of the
+/// 3x3 neighbourhood index.
+constexpr unsigned kRingBit[8] = {1, 2, 5, 8, 7, 6, 3, 0};
+
+/// One neighbourhood per letter for counts 1 to 4, as ring masks (bit i is
+/// ring position i). Counts 5 to 7 use the complements of 3 to 1.
+constexpr std::uint8_t kRepresentative[5][13] = {
+    {},
+    {0x02, 0x01},
+    {0x0a, 0x05, 0x09, 0x03, 0x11, 0x22},
+    {0x2a, 0x15, 0x25, 0x07, 0x83, 0x0b, 0x29, 0x23, 0x43, 0x13},
+    {0xaa, 0x55, 0x4b, 0x0f, 0x1b, 0x8b, 0x2b, 0x27, 0x53, 0x17, 0x93, 0x63, 0x33},
+};
+
+std::uint8_t rotate(std::uint8_t ring) // by 90 degrees: two ring positions
+{
+    return static_cast<std::uint8_t>((ring << 2) | (ring >> 6));
+}
+
+std::uint8_t mirror(std::uint8_t ring) // about the vertical axis: i -> -i mod 8
+{
+    std::uint8_t out = 0;
+    for (unsigned i = 0; i < 8; ++i)
+        if ((ring >> i) & 1u)
+            out |= static_cast<std::uint8_t>(1u << ((8 - i) & 7));
+    return out;
+}
+
+/// Letter index of every ring mask within its neighbour count.
+struct LetterTable {
+    std::uint8_t letter[256] = {};
+
+    LetterTable()
+    {
+        for (unsigned k = 1; k <= 4; ++k)
+            for (unsigned l = 0; l < kLetterCount[k]; ++l) {
+                std::uint8_t m = kRepresentative[k][l];
+                for (int r = 0; r < 4; ++r, m = rotate(m))
+                    for (std::uint8_t image : {m, mirror(m)}) {
+                        letter[image] = static_cast<std::uint8_t>(l);
+                        if (k < 4)
+                            letter[static_cast<std::uint8_t>(~image)] = static_cast<std::uint8_t>(l);
+                    }
+            }
+    }
+};
+
+const LetterTable& letters()
+{
+    static const LetterTable table;
+    return table;
+}
+
+std::uint8_t ring_of(std::uint32_t n)
+{
+    std::uint8_t ring = 0;
+    for (unsigned i = 0; i < 8; ++i)
+        if ((n >> kRingBit[i]) & 1u)
+            ring |= static_cast<std::uint8_t>(1u << i);
+    return ring;
+}
+
+std::uint32_t neighbourhood_of(std::uint8_t ring, bool alive)
+{
+    std::uint32_t n = alive ? 0x10u : 0u;
+    for (unsigned i = 0; i < 8; ++i)
+        if ((ring >> i) & 1u)
+            n |= 1u << kRingBit[i];
+    return n;
+}
+
+std::uint16_t full_letters(unsigned count)
+{
+    return static_cast<std::uint16_t>((1u << kLetterCount[count]) - 1);
+}
+
+/// True if a letter set includes every neighbourhood with `count` neighbours.
+bool covers(std::uint16_t set, unsigned count)
+{
+    return (set & 0x8000u) || (set && (set & full_letters(count)) == full_letters(count));
+}
+
+/// Parses one B or S field into a letter set per neighbour count; a bare
+/// count without letters (or count 0 / 8) stands for all of them, marked
+/// by bit 15.
+void parse_field(std::string_view field, std::string_view whole, std::uint16_t (&sets)[9])
+{
+    auto bad = [&] { return std::runtime_error("bad rule '" + std::string(whole) + "'"); };
+    std::size_t i = 0;
+    while (i < field.size()) {
+        const char ch = field[i++];
+        if (ch < '0' || ch > '8')
+            throw bad();
+        const unsigned k = static_cast<unsigned>(ch - '0');
+        const bool negate = i < field.size() && field[i] == '-';
+        if (negate)
+            ++i;
+        std::uint16_t set = 0;
+        bool any = false;
+        for (; i < field.size() && std::isalpha(static_cast<unsigned char>(field[i])); ++i) {
+            const std::size_t l = kLetters.find(field[i]);
+            if (l == std::string_view::npos || l >= kLetterCount[k])
+                throw bad();
+            set |= static_cast<std::uint16_t>(1u << l);
+            any = true;
+        }
+        if (negate && !any)
+            throw bad();
+        if (!any)
+            set = 0x8000u;
+        else if (negate)
+            set = static_cast<std::uint16_t>(full_letters(k) & ~set);
+        sets[k] |= set;
+    }
+}
+
+/// Builds the rule from per-count letter sets, collapsing it to the
+/// outer-totalistic form when every count is all-or-nothing.
+Rule build(const std::uint16_t (&birth)[9], const std::uint16_t (&survive)[9])
+{
+    Rule rule;
+    bool totalistic = true;
+    for (unsigned k = 0; k <= 8; ++k) {
+        for (int alive = 0; alive < 2; ++alive) {
+            const std::uint16_t set = alive ? survive[k] : birth[k];
+            if (covers(set, k))
+                (alive ? rule.survive : rule.birth) |= static_cast<std::uint16_t>(1u << k);
+            else if (set)
+                totalistic = false;
+        }
+    }
+    if (totalistic)
+        return rule;
+    for (std::uint32_t n = 0; n < 512; ++n) {
+        const std::uint8_t ring = ring_of(n);
+        const unsigned k = static_cast<unsigned>(std::popcount(ring));
+        const std::uint16_t set = (n & 0x10u) ? survive[k] : birth[k];
+        if (covers(set, k) || ((set >> letters().letter[ring]) & 1u))
+            rule.table[n >> 6] |= std::uint64_t{1} << (n & 63);
+    }
+    return rule;
+}
+
+/// Parses the B/S part of a rule, already lower-cased and without spaces.
+Rule parse_life_like(const std::string& s, std::string_view text)
+{
+    std::uint16_t birth[9] = {}, survive[9] = {};
+    const std::size_t b = s.find('b');
+    const std::size_t sv = s.find('s');
+    if (b != std::string::npos && sv != std::string::npos) {
+        // B.../S... or S.../B..., with or without the slash.
+        auto field = [&](std::size_t at) {
+            std::size_t end = at + 1;
+            while (end < s.size() && s[end] != '/' && s[end] != 'b' && s[end] != 's')
+                ++end;
+            return std::string_view(s).substr(at + 1, end - at - 1);
+        };
+        parse_field(field(b), text, birth);
+        parse_field(field(sv), text, survive);
+        return build(birth, survive);
+    }
+
+    const std::size_t slash = s.find('/');
+    if (slash == std::string::npos || b != std::string::npos || sv != std::string::npos)
+        throw std::runtime_error("bad rule '" + std::string(text) + "'");
+    parse_field(std::string_view(s).substr(0, slash), text, survive);
+    parse_field(std::string_view(s).substr(slash + 1), text, birth);
+    return build(birth, survive);
+}
+
+} // namespace
+
+Rule Rule::parse(std::string_view text)
+{
+    std::string s;
+    for (char ch : text)
+        if (!std::isspace(static_cast<unsigned char>(ch)))
+            s.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
+    if (s.empty())
+        throw std::runtime_error("empty rule");
+
+    // Generations: a trailing "/C<n>", "/G<n>" or "/<n>" field.
+    std::uint16_t states = 2;
+    if (std::count(s.begin(), s.end(), '/') == 2) {
+        const std::size_t slash = s.rfind('/');
+        std::string_view field = std::string_view(s).substr(slash + 1);
+        if (!field.empty() && (field[0] == 'c' || field[0] == 'g'))
+            field.remove_prefix(1);
+        unsigned n = 0;
+        const auto r = std::from_chars(field.data(), field.data() + field.size(), n);
+        if (field.empty() || r.ec != std::errc() || r.ptr != field.data() + field.size() || n < 2
+            || n > 256)
+            throw std::runtime_error("bad rule '" + std::string(text) + "'");
+        states = static_cast<std::uint16_t>(n);
+        s.resize(slash);
+    }
+
+    Rule rule = parse_life_like(s, text);
+    rule.states = states;
+    return rule;
+}
+
+std::string Rule::to_string() const
+{
+    std::string out;
+    for (int alive = 0; alive < 2; ++alive) {
+        out += alive ? "/S" : "B";
+        const std::uint16_t counts = alive ? survive : birth;
+        for (unsigned k = 0; k <= 8; ++k) {
+            if ((counts >> k) & 1u) {
+                out.push_back(static_cast<char>('0' + k));
+                continue;
+            }
+            if (totalistic() || kLetterCount[k] == 0)
+                continue;
+            // Letters present, spelled as a list or as "-" and the missing
+            // ones, whichever is shorter.
+            std::string present, missing;
+            for (unsigned l = 0; l < kLetterCount[k]; ++l) {
+                const std::uint8_t ring = k <= 4 ? kRepresentative[k][l]
+                                                 : static_cast<std::uint8_t>(~kRepresentative[8 - k][l]);
+                (next_state(neighbourhood_of(ring, alive)) ? present : missing).push_back(kLetters[l]);
+            }
+            if (present.empty())
+                continue;
+            out.push_back(static_cast<char>('0' + k));
+            out += missing.size() < present.size() ? "-" + missing : present;
+        }
+    }
+    if (generations())
+        out += "/C" + std::to_string(states);
+    return out;
+}
+
+std::array<std::uint64_t, 8> Rule::neighbourhood_table() const
+{
+    if (!totalistic())
+        return table;
+    std::array<std::uint64_t, 8> out{};
+    for (std::uint32_t n = 0; n < 512; ++n)
+        if (next_state(n))
+            out[n >> 6] |= std::uint64_t{1} << (n & 63);
+    return out;
+}
+
+} // namespace conway
@@ -0,0 +1,272 @@
+#include "conway/snapshot.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace conway {
+
+static_assert(std::endian::native == std::endian::little, "snapshots are written in host byte order");
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'W', 'S', 'N', 'A', 'P', '\r', '\n'};
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t tile_rows;
+    std::uint64_t width;
+    std::uint64_t height;
+    std::uint64_t generation;
+    std::uint64_t population;
+    std::uint64_t index_offset;
+    std::uint32_t rule_size;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(Header) == 64);
+
+/// Where and how one tile is stored; empty tiles have offset and size 0.
+struct TileEntry {
+    std::uint64_t offset;
+    std::uint32_t size;
+    std::uint8_t encoding;
+    std::uint8_t reserved[3];
+};
+static_assert(sizeof(TileEntry) == 16);
+
+TileEntry read_entry(const char* index, std::size_t i)
+{
+    TileEntry e;
+    std::memcpy(&e, index + i * sizeof e, sizeof e);
+    return e;
+}
+
+std::uint64_t align_up(std::uint64_t v, std::uint64_t to)
+{
+    return (v + to - 1) / to * to;
+}
+
+/// Bit i set if byte i of w is non-zero.
+unsigned nonzero_bytes(std::uint64_t w)
+{
+    constexpr std::uint64_t kLow7 = 0x7f7f7f7f7f7f7f7full;
+    const std::uint64_t high = (((w & kLow7) + kLow7) | w) & ~kLow7;
+    // Byte i's flag sits at bit 8i + 7; the multiply moves it to bit 56 + i.
+    return static_cast<unsigned>(((high >> 7) * 0x0102040810204080ull) >> 56);
+}
+
+/// Rows of tile row ty on a board `height` rows high.
+std::size_t tile_rows(std::size_t height, std::size_t ty)
+{
+    return std::min(Snapshot::kTileRows, height - ty * Snapshot::kTileRows);
+}
+
+void pad_to(BufferedWriter& out, std::uint64_t offset)
+{
+    while (out.bytes_written() < offset)
+        out.put('\0');
+}
+
+[[noreturn]] void corrupt(const char* what)
+{
+    throw std::runtime_error(std::string("corrupt snapshot: ") + what);
+}
+
+} // namespace
+
+bool Snapshot::is_snapshot(std::string_view data)
+{
+    return data.size() >= sizeof kMagic && std::memcmp(data.data(), kMagic, sizeof kMagic) == 0;
+}
+
+Snapshot::Snapshot(const MappedFile& file) : data_(file.data()), size_(file.size())
+{
+    if (!is_snapshot(file.view()) || size_ < sizeof(Header))
+        throw std::runtime_error("not a snapshot");
+    Header h;
+    std::memcpy(&h, data_, sizeof h);
+    if (h.version != kVersion)
+        throw std::runtime_error("unsupported snapshot version " + std::to_string(h.version));
+    if (h.tile_rows != kTileRows || h.width % Grid::kWordBits != 0)
+        corrupt("bad tile size");
+    if (sizeof h + h.rule_size > size_)
+        corrupt("truncated header");
+    width_ = h.width;
+    height_ = h.height;
+    generation_ = h.generation;
+    population_ = h.population;
+    rule_.assign(data_ + sizeof h, h.rule_size);
+    tiles_x_ = width_ / Grid::kWordBits;
+    tiles_y_ = (height_ + kTileRows - 1) / kTileRows;
+    const std::uint64_t tiles = static_cast<std::uint64_t>(tiles_x_) * tiles_y_;
+    if (h.index_offset % 8 != 0 || h.index_offset > size_ || tiles > (size_ - h.index_offset) / sizeof(TileEntry))
+        corrupt("truncated index");
+    index_ = data_ + h.index_offset;
+
+    for (std::size_t ty = 0; ty < tiles_y_; ++ty) {
+        const std::size_t rows = tile_rows(height_, ty);
+        for (std::size_t tx = 0; tx < tiles_x_; ++tx) {
+            const TileEntry e = read_entry(index_, ty * tiles_x_ + tx);
+            if (e.offset > size_ || e.size > size_ - e.offset)
+                corrupt("payload outside the file");
+            switch (static_cast<Encoding>(e.encoding)) {
+            case Encoding::empty:
+                if (e.size != 0)
+                    corrupt("empty tile with a payload");
+                break;
+            case Encoding::raw:
+                if (e.size != rows * 8 || e.offset % 8 != 0)
+                    corrupt("raw tile of the wrong size");
+                break;
+            case Encoding::sparse:
+                if (e.size < rows)
+                    corrupt("sparse tile too short");
+                break;
+            default:
+                corrupt("unknown tile encoding");
+            }
+        }
+    }
+}
+
+void Snapshot::load(Grid& grid) const
+{
+    if (grid.width() != width_ || grid.height() != height_)
+        throw std::runtime_error("snapshot is " + std::to_string(width_) + "x" + std::to_string(height_) +
+                                 ", board is " + std::to_string(grid.width()) + "x" +
+                                 std::to_string(grid.height()));
+    const std::size_t stride = grid.words_per_row();
+    for (std::size_t ty = 0; ty < tiles_y_; ++ty) {
+        const std::size_t rows = tile_rows(height_, ty);
+        for (std::size_t tx = 0; tx < tiles_x_; ++tx) {
+            const TileEntry e = read_entry(index_, ty * tiles_x_ + tx);
+            std::uint64_t* out = grid.row(ty * kTileRows) + tx;
+            const char* p = data_ + e.offset;
+            switch (static_cast<Encoding>(e.encoding)) {
+            case Encoding::empty:
+                for (std::size_t r = 0; r < rows; ++r)
+                    out[r * stride] = 0;
+                break;
+            case Encoding::raw:
+                for (std::size_t r = 0; r < rows; ++r)
+                    std::memcpy(&out[r * stride], p + 8 * r, 8);
+                break;
+            case Encoding::sparse: {
+                const auto* masks = reinterpret_cast<const std::uint8_t*>(p);
+                const auto* bytes = masks + rows;
+                const auto* end = masks + e.size;
+                for (std::size_t r = 0; r < rows; ++r) {
+                    unsigned m = masks[r];
+                    if (static_cast<std::size_t>(end - bytes) < static_cast<std::size_t>(std::popcount(m)))
+                        corrupt("sparse tile overruns its payload");
+                    std::uint64_t w = 0;
+                    for (; m; m &= m - 1)
+                        w |= static_cast<std::uint64_t>(*bytes++) << (8 * std::countr_zero(m));
+                    out[r * stride] = w;
+                }
+                break;
+            }
+            }
+        }
+    }
+}
+
+void write_snapshot(BufferedWriter& out, const Grid& grid, const Rule& rule, std::uint64_t generation,
+                    bool compress)
+{
+    const std::size_t tiles_x = grid.words_per_row();
+    const std::size_t tiles_y = (grid.height() + Snapshot::kTileRows - 1) / Snapshot::kTileRows;
+    const std::size_t stride = grid.words_per_row();
+    const std::string rule_text = rule.to_string();
+
+    // First pass: pick each tile's encoding, so the index and every payload
+    // offset are known before anything is written.
+    std::vector<TileEntry> index(tiles_x * tiles_y);
+    std::uint64_t population = 0;
+    for (std::size_t ty = 0; ty < tiles_y; ++ty) {
+        const std::size_t rows = tile_rows(grid.height(), ty);
+        for (std::size_t tx = 0; tx < tiles_x; ++tx) {
+            const std::uint64_t* in = grid.row(ty * Snapshot::kTileRows) + tx;
+            std::uint64_t any = 0;
+            std::size_t bytes = 0;
+            for (std::size_t r = 0; r < rows; ++r) {
+                const std::uint64_t w = in[r * stride];
+                any |= w;
+                population += static_cast<std::uint64_t>(std::popcount(w));
+                if (compress)
+                    bytes += static_cast<std::size_t>(std::popcount(nonzero_bytes(w)));
+            }
+            TileEntry& e = index[ty * tiles_x + tx];
+            e = {};
+            if (!any) {
+                e.encoding = static_cast<std::uint8_t>(Snapshot::Encoding::empty);
+            } else if (compress && rows + bytes < rows * 8) {
+                e.encoding = static_cast<std::uint8_t>(Snapshot::Encoding::sparse);
+                e.size = static_cast<std::uint32_t>(rows + bytes);
+            } else {
+                e.encoding = static_cast<std::uint8_t>(Snapshot::Encoding::raw);
+                e.size = static_cast<std::uint32_t>(rows * 8);
+            }
+        }
+    }
+
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = Snapshot::kVersion;
+    h.tile_rows = Snapshot::kTileRows;
+    h.width = grid.width();
+    h.height = grid.height();
+    h.generation = generation;
+    h.population = population;
+    h.index_offset = align_up(sizeof h + rule_text.size(), 8);
+    h.rule_size = static_cast<std::uint32_t>(rule_text.size());
+    std::uint64_t offset = h.index_offset + index.size() * sizeof(TileEntry);
+    for (std::size_t ty = 0; ty < tiles_y; ++ty) {
+        offset = align_up(offset, Snapshot::kPageSize);
+        for (std::size_t tx = 0; tx < tiles_x; ++tx) {
+            TileEntry& e = index[ty * tiles_x + tx];
+            if (e.size == 0)
+                continue;
+            e.offset = offset;
+            offset = align_up(offset + e.size, 8);
+        }
+    }
+
+    out.write(std::string_view(reinterpret_cast<const char*>(&h), sizeof h));
+    out.write(rule_text);
+    pad_to(out, h.index_offset);
+    out.write(std::string_view(reinterpret_cast<const char*>(index.data()), index.size() * sizeof index[0]));
+
+    char payload[Snapshot::kTileRows * 9];
+    for (std::size_t ty = 0; ty < tiles_y; ++ty) {
+        const std::size_t rows = tile_rows(grid.height(), ty);
+        for (std::size_t tx = 0; tx < tiles_x; ++tx) {
+            const TileEntry& e = index[ty * tiles_x + tx];
+            if (e.size == 0)
+                continue;
+            pad_to(out, e.offset);
+            const std::uint64_t* in = grid.row(ty * Snapshot::kTileRows) + tx;
+            if (static_cast<Snapshot::Encoding>(e.encoding) == Snapshot::Encoding::raw) {
+                for (std::size_t r = 0; r < rows; ++r)
+                    std::memcpy(payload + 8 * r, &in[r * stride], 8);
+            } else {
+                char* bytes = payload + rows;
+                for (std::size_t r = 0; r < rows; ++r) {
+                    const std::uint64_t w = in[r * stride];
+                    const unsigned m = nonzero_bytes(w);
+                    payload[r] = static_cast<char>(m);
+                    for (unsigned b = m; b; b &= b - 1)
+                        *bytes++ = static_cast<char>(w >> (8 * std::countr_zero(b)));
+                }
+            }
+            out.write(std::string_view(payload, e.size));
+        }
+    }
+    // Pad the last payload out to a whole word, as every other one is.
+    pad_to(out, offset);
+}
+
+} // namespace conway
@@ -0,0 +1,383 @@
+#include "conway/sparse_engine.hpp"
+
+#include "conway/bitlife.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace conway {
+
+namespace {
+
+/// Tile offsets in neighbour-slot order nw, n, ne, w, e, sw, s, se; slot d
+/// and slot 7 - d are opposite each other.
+constexpr int kDx[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+constexpr int kDy[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+
+} // namespace
+
+SparseEngine::SparseEngine(const Rule& rule)
+    : rule_(rule)
+{
+    if (rule_.next_state(0))
+        throw std::runtime_error("B0 rules cannot run on an unbounded plane");
+    if (rule_.generations())
+        throw std::runtime_error("Generations rules need the generations engine");
+}
+
+std::size_t SparseEngine::memory_bytes() const
+{
+    // Tile records plus a rough per-entry cost for the hash map.
+    return index_.size() * (sizeof(Tile) + 4 * sizeof(void*));
+}
+
+std::uint32_t SparseEngine::find(std::int32_t tx, std::int32_t ty) const
+{
+    const auto it = index_.find(key(tx, ty));
+    return it == index_.end() ? kNone : it->second;
+}
+
+std::uint32_t SparseEngine::ensure(std::int32_t tx, std::int32_t ty)
+{
+    const std::uint32_t existing = find(tx, ty);
+    if (existing != kNone)
+        return existing;
+
+    std::uint32_t id;
+    if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+    } else {
+        id = static_cast<std::uint32_t>(tiles_.size());
+        tiles_.emplace_back();
+    }
+    Tile& t = tiles_[id];
+    t.rows[0].fill(0);
+    t.rows[1].fill(0);
+    t.tx = tx;
+    t.ty = ty;
+    t.population = 0;
+    t.cur = 0;
+    t.changed = 0;
+    t.active = 0;
+    t.in_use = 1;
+    for (int d = 0; d < 8; ++d) {
+        const std::uint32_t n = find(tx + kDx[d], ty + kDy[d]);
+        t.nbr[d] = n;
+        if (n != kNone)
+            tiles_[n].nbr[7 - d] = id;
+    }
+    index_.emplace(key(tx, ty), id);
+    return id;
+}
+
+void SparseEngine::release(std::uint32_t id)
+{
+    Tile& t = tiles_[id];
+    for (int d = 0; d < 8; ++d)
+        if (t.nbr[d] != kNone)
+            tiles_[t.nbr[d]].nbr[7 - d] = kNone;
+    index_.erase(key(t.tx, t.ty));
+    t.in_use = 0;
+    free_.push_back(id);
+}
+
+void SparseEngine::ensure_neighbours(std::uint32_t id)
+{
+    for (int d = 0; d < 8; ++d)
+        if (tiles_[id].nbr[d] == kNone) {
+            const std::int32_t tx = tiles_[id].tx + kDx[d];
+            const std::int32_t ty = tiles_[id].ty + kDy[d];
+            ensure(tx, ty);
+        }
+}
+
+void SparseEngine::set_cell(std::int64_t x, std::int64_t y, bool alive)
+{
+    const auto tx = static_cast<std::int32_t>(x >> 6);
+    const auto ty = static_cast<std::int32_t>(y >> 6);
+    if (!alive && find(tx, ty) == kNone)
+        return;
+    const std::uint32_t id = ensure(tx, ty);
+    Tile& t = tiles_[id];
+    std::uint64_t& word = t.rows[t.cur][static_cast<std::size_t>(y & 63)];
+    const std::uint64_t bit = std::uint64_t{1} << (x & 63);
+    if (((word & bit) != 0) == alive)
+        return;
+    word ^= bit;
+    if (alive) {
+        ++t.population;
+        ++population_;
+    } else {
+        --t.population;
+        --population_;
+    }
+    // An edit may sit on any edge, so it wakes every neighbour.
+    if (!t.changed)
+        changed_list_.push_back(id);
+    t.changed = kChangedAll;
+}
+
+bool SparseEngine::get_cell(std::int64_t x, std::int64_t y) const
+{
+    const std::uint32_t id = find(static_cast<std::int32_t>(x >> 6), static_cast<std::int32_t>(y >> 6));
+    if (id == kNone)
+        return false;
+    const Tile& t = tiles_[id];
+    return (t.rows[t.cur][static_cast<std::size_t>(y & 63)] >> (x & 63)) & 1u;
+}
+
+void SparseEngine::clear()
+{
+    tiles_.clear();
+    free_.clear();
+    index_.clear();
+    changed_list_.clear();
+    active_list_.clear();
+    generation_ = 0;
+    population_ = 0;
+    active_tiles_ = 0;
+}
+
+template <class Eval>
+void SparseEngine::compute(const Eval& eval, std::uint32_t id)
+{
+    static const std::array<std::uint64_t, kTileSize> kEmpty{};
+    Tile& t = tiles_[id];
+    auto rows_of = [&](int slot) -> const std::array<std::uint64_t, kTileSize>& {
+        const std::uint32_t n = slot < 0 ? id : t.nbr[slot];
+        if (n == kNone)
+            return kEmpty;
+        return tiles_[n].rows[tiles_[n].cur];
+    };
+
+    // Columns west, centre and east of this tile, with one halo row above
+    // and below, so the inner loop is branch-free.
+    std::uint64_t col[3][kTileSize + 2];
+    const int above[3] = {0, 1, 2}, side[3] = {3, -1, 4}, below[3] = {5, 6, 7};
+    for (int c = 0; c < 3; ++c) {
+        const auto& mid = rows_of(side[c]);
+        col[c][0] = rows_of(above[c])[kTileSize - 1];
+        std::copy(mid.begin(), mid.end(), &col[c][1]);
+        col[c][kTileSize + 1] = rows_of(below[c])[0];
+    }
+
+    auto& out = t.rows[t.cur ^ 1];
+    std::uint64_t diff = 0;
+    std::uint32_t population = 0;
+    for (std::size_t y = 0; y < kTileSize; ++y) {
+        const std::uint64_t next = next_word(eval,
+            col[0][y], col[1][y], col[2][y],
+            col[0][y + 1], col[1][y + 1], col[2][y + 1],
+            col[0][y + 2], col[1][y + 2], col[2][y + 2]);
+        diff |= next ^ col[1][y + 1];
+        population += static_cast<std::uint32_t>(std::popcount(next));
+        out[y] = next;
+    }
+    const std::uint64_t diff_top = out[0] ^ col[1][1];
+    const std::uint64_t diff_bottom = out[kTileSize - 1] ^ col[1][kTileSize];
+    population_ += population;
+    population_ -= t.population;
+    t.population = population;
+    if (!diff) {
+        t.changed = 0;
+    } else if (!population) {
+        // Emptied: wake the whole ring so empty neighbours get their
+        // release check.
+        t.changed = kChangedAll;
+    } else {
+        // Bits in nbr order: nw, n, ne, w, e, sw, s, se.
+        t.changed = static_cast<std::uint16_t>(kChangedSelf | (diff_top & 1) | (diff_top != 0) << 1
+                                               | (diff_top >> 63) << 2 | (diff & 1) << 3
+                                               | (diff >> 63) << 4 | (diff_bottom & 1) << 5
+                                               | (diff_bottom != 0) << 6 | (diff_bottom >> 63) << 7);
+    }
+}
+
+void SparseEngine::step()
+{
+    // Every tile that changed and holds live cells gets its full ring of
+    // neighbours before anything is computed.
+    for (std::uint32_t id : changed_list_)
+        if (tiles_[id].in_use && tiles_[id].population)
+            ensure_neighbours(id);
+
+    active_list_.clear();
+    auto activate = [this](std::uint32_t id) {
+        if (id != kNone && !tiles_[id].active) {
+            tiles_[id].active = 1;
+            active_list_.push_back(id);
+        }
+    };
+    for (std::uint32_t id : changed_list_) {
+        const Tile& t = tiles_[id];
+        if (!t.in_use)
+            continue;
+        activate(id);
+        for (int d = 0; d < 8; ++d)
+            if (t.changed >> d & 1)
+                activate(t.nbr[d]);
+    }
+
+    constexpr Rule highlife = Rule::highlife(), day_and_night = Rule::day_and_night();
+    if (!rule_.totalistic()) {
+        const DecisionEval eval(rule_.table);
+        for (std::uint32_t id : active_list_)
+            compute(eval, id);
+    } else if (rule_.is_life()) {
+        for (std::uint32_t id : active_list_)
+            compute(LifeEval{}, id);
+    } else if (rule_ == highlife) {
+        for (std::uint32_t id : active_list_)
+            compute(FixedEval<highlife.birth, highlife.survive>{}, id);
+    } else if (rule_ == day_and_night) {
+        for (std::uint32_t id : active_list_)
+            compute(FixedEval<day_and_night.birth, day_and_night.survive>{}, id);
+    } else {
+        const TableEval eval(rule_.birth, rule_.survive);
+        for (std::uint32_t id : active_list_)
+            compute(eval, id);
+    }
+
+    changed_list_.clear();
+    for (std::uint32_t id : active_list_) {
+        Tile& t = tiles_[id];
+        t.cur ^= 1;
+        t.active = 0;
+        if (t.changed)
+            changed_list_.push_back(id);
+    }
+
+    // Release tiles that are empty and border no live tile. Only tiles
+    // stepped this generation can have become releasable, plus the empty
+    // neighbours of a released tile, which may have been kept only for it:
+    // they are appended to the list and checked in the same pass.
+    active_tiles_ = active_list_.size();
+    for (std::size_t i = 0; i < active_list_.size(); ++i) {
+        const Tile& t = tiles_[active_list_[i]];
+        if (!t.in_use || t.population)
+            continue;
+        bool lonely = true;
+        for (std::uint32_t n : t.nbr)
+            if (n != kNone && tiles_[n].population) {
+                lonely = false;
+                break;
+            }
+        if (!lonely)
+            continue;
+        for (std::uint32_t n : t.nbr)
+            if (n != kNone)
+                active_list_.push_back(n);
+        release(active_list_[i]);
+    }
+
+    ++generation_;
+}
+
+void SparseEngine::run(std::uint64_t generations)
+{
+    for (std::uint64_t g = 0; g < generations; ++g)
+        step();
+}
+
+bool SparseEngine::bounds(std::int64_t& x0, std::int64_t& y0, std::int64_t& x1, std::int64_t& y1) const
+{
+    bool any = false;
+    for (const auto& [k, id] : index_) {
+        const Tile& t = tiles_[id];
+        if (!t.population)
+            continue;
+        std::uint64_t columns = 0;
+        std::size_t top = kTileSize, bottom = 0;
+        for (std::size_t y = 0; y < kTileSize; ++y) {
+            const std::uint64_t w = t.rows[t.cur][y];
+            if (!w)
+                continue;
+            columns |= w;
+            top = std::min(top, y);
+            bottom = y + 1;
+        }
+        const std::int64_t bx = std::int64_t{t.tx} * kTileSize;
+        const std::int64_t by = std::int64_t{t.ty} * kTileSize;
+        const std::int64_t tx0 = bx + std::countr_zero(columns);
+        const std::int64_t tx1 = bx + 64 - std::countl_zero(columns);
+        const std::int64_t ty0 = by + static_cast<std::int64_t>(top);
+        const std::int64_t ty1 = by + static_cast<std::int64_t>(bottom);
+        if (!any) {
+            x0 = tx0, x1 = tx1, y0 = ty0, y1 = ty1;
+            any = true;
+        } else {
+            x0 = std::min(x0, tx0), x1 = std::max(x1, tx1);
+            y0 = std::min(y0, ty0), y1 = std::max(y1, ty1);
+        }
+    }
+    return any;
+}
+
+void SparseEngine::for_each_live(CellSink& sink) const
+{
+    for (const auto& [k, id] : index_) {
+        const Tile& t = tiles_[id];
+        if (!t.population)
+            continue;
+        for (std::size_t y = 0; y < kTileSize; ++y) {
+            std::uint64_t w = t.rows[t.cur][y];
+            while (w) {
+                const int start = std::countr_zero(w);
+                const int len = std::countr_one(w >> start);
+                sink.live_run(std::int64_t{t.tx} * kTileSize + start,
+                              std::int64_t{t.ty} * kTileSize + static_cast<std::int64_t>(y), len);
+                w = len == 64 ? 0 : w & ~(((std::uint64_t{1} << len) - 1) << start);
+            }
+        }
+    }
+}
+
+void SparseEngine::write_rle(BufferedWriter& out) const
+{
+    std::int64_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    bounds(x0, y0, x1, y1);
+    RleWriter rle(out, x1 - x0, y1 - y0, rule_);
+
+    // Non-empty tiles in raster order: by tile row, then west to east.
+    std::vector<std::uint32_t> order;
+    for (const auto& [k, id] : index_)
+        if (tiles_[id].population)
+            order.push_back(id);
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        const Tile& ta = tiles_[a];
+        const Tile& tb = tiles_[b];
+        return ta.ty != tb.ty ? ta.ty < tb.ty : ta.tx < tb.tx;
+    });
+
+    std::int64_t row = y0;
+    for (std::size_t band = 0; band < order.size();) {
+        std::size_t end = band;
+        while (end < order.size() && tiles_[order[end]].ty == tiles_[order[band]].ty)
+            ++end;
+        const std::int64_t by = std::int64_t{tiles_[order[band]].ty} * kTileSize;
+        for (std::size_t y = 0; y < kTileSize; ++y) {
+            bool started = false;
+            for (std::size_t i = band; i < end; ++i) {
+                const Tile& t = tiles_[order[i]];
+                std::uint64_t w = t.rows[t.cur][y];
+                if (w && !started) {
+                    rle.next_row(by + static_cast<std::int64_t>(y) - row);
+                    row = by + static_cast<std::int64_t>(y);
+                    started = true;
+                }
+                while (w) {
+                    const int start = std::countr_zero(w);
+                    const int len = std::countr_one(w >> start);
+                    rle.live(std::int64_t{t.tx} * kTileSize + start - x0, len);
+                    w = len == 64 ? 0 : w & ~(((std::uint64_t{1} << len) - 1) << start);
+                }
+            }
+        }
+        band = end;
+    }
+    rle.finish();
+}
+
+} // namespace conway
@@ -0,0 +1,282 @@
+#include "conway/terminal_renderer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace conway {
+
+namespace {
+
+/// Unchanged cells between two changed spans of a row that are rewritten
+/// rather than skipped with a cursor move (which costs 6 to 10 bytes).
+constexpr std::size_t kMergeGap = 4;
+
+/// kSpread[b] has byte i set to bit i of b: eight cells to eight codes.
+constexpr auto kSpread = [] {
+    std::array<std::uint64_t, 256> t{};
+    for (std::size_t b = 0; b < 256; ++b)
+        for (std::size_t i = 0; i < 8; ++i)
+            t[b] |= static_cast<std::uint64_t>(b >> i & 1) << (8 * i);
+    return t;
+}();
+
+/// Bit of a braille code, U+2800 + code, that shows cell (dx, dy) of its
+/// 2 x 4 block. Dots 1-6 run down the left column then the right; dots 7
+/// and 8 are the bottom row, added later to the standard.
+constexpr unsigned kBrailleDot[2][4] = {{0, 1, 2, 6}, {3, 4, 5, 7}};
+
+/// Moves the even-numbered bits of v, in order, to its low 32 bits.
+std::uint64_t even_bits(std::uint64_t v)
+{
+    v &= 0x5555555555555555ull;
+    v = (v | v >> 1) & 0x3333333333333333ull;
+    v = (v | v >> 2) & 0x0f0f0f0f0f0f0f0full;
+    v = (v | v >> 4) & 0x00ff00ff00ff00ffull;
+    v = (v | v >> 8) & 0x0000ffff0000ffffull;
+    v = (v | v >> 16) & 0x00000000ffffffffull;
+    return v;
+}
+
+std::vector<std::string> glyph_table(TerminalRenderer::Glyphs glyphs)
+{
+    switch (glyphs) {
+    case TerminalRenderer::Glyphs::cell:
+        return {" ", "\xe2\x96\x88"};
+    case TerminalRenderer::Glyphs::half:
+        // Bit 0 is the upper cell, bit 1 the lower.
+        return {" ", "\xe2\x96\x80", "\xe2\x96\x84", "\xe2\x96\x88"};
+    case TerminalRenderer::Glyphs::braille:
+        break;
+    }
+    // The empty pattern is drawn as a space: it looks the same, is a third
+    // of the bytes, and is what a cleared screen already shows.
+    std::vector<std::string> t{" "};
+    for (unsigned c = 1; c < 256; ++c)
+        t.push_back({'\xe2', static_cast<char>(0xa0 + (c >> 6)), static_cast<char>(0x80 + (c & 0x3f))});
+    return t;
+}
+
+std::uint64_t load8(const std::uint8_t* p)
+{
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+/// ORs `codes` into the eight code bytes at p.
+void or8(std::uint8_t* p, std::uint64_t codes)
+{
+    codes |= load8(p);
+    std::memcpy(p, &codes, sizeof codes);
+}
+
+/// The 64 cells of `row` starting at x, wrapping round the torus.
+std::uint64_t gather(const std::uint64_t* row, std::size_t words, std::size_t x)
+{
+    const std::size_t w = x / 64;
+    const unsigned s = static_cast<unsigned>(x % 64);
+    std::uint64_t bits = row[w] >> s;
+    if (s)
+        bits |= row[w + 1 == words ? 0 : w + 1] << (64 - s);
+    return bits;
+}
+
+std::size_t csi_length(std::size_t x, std::size_t y)
+{
+    // ESC [ row ; col H
+    auto digits = [](std::size_t v) { return v < 10 ? 1u : v < 100 ? 2u : v < 1000 ? 3u : v < 10000 ? 4u : 5u; };
+    return 4 + digits(y + 1) + digits(x + 1);
+}
+
+} // namespace
+
+TerminalRenderer::TerminalRenderer(int fd, std::size_t columns, std::size_t rows, Glyphs glyphs)
+    : fd_(fd)
+    , columns_(columns)
+    , rows_(rows)
+    , mode_(glyphs)
+    , cell_width_(glyphs == Glyphs::braille ? 2 : 1)
+    , cell_height_(glyphs == Glyphs::braille ? 4 : glyphs == Glyphs::half ? 2 : 1)
+    , glyphs_(glyph_table(glyphs))
+    , stride_((columns + 7) / 8 * 8)
+    , frame_(stride_ * rows)
+    , shown_(stride_ * rows)
+{
+    if (columns == 0 || rows == 0)
+        throw std::runtime_error("the render area needs at least one row and column");
+}
+
+TerminalRenderer::~TerminalRenderer()
+{
+    if (!drawn_)
+        return;
+    out_.clear();
+    move_to(0, rows_ + 1);
+    out_ += "\x1b[?25h";
+    try {
+        send();
+    } catch (...) {
+    }
+}
+
+void TerminalRenderer::terminal_size(int fd, std::size_t& columns, std::size_t& rows)
+{
+    winsize ws{};
+    if (::ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        columns = ws.ws_col;
+        rows = ws.ws_row;
+    } else {
+        columns = 80;
+        rows = 24;
+    }
+}
+
+void TerminalRenderer::sample(const Grid& board, std::size_t x0, std::size_t y0)
+{
+    std::fill(frame_.begin(), frame_.end(), 0);
+    if (mode_ == Glyphs::braille) {
+        sample_braille(board, x0, y0);
+        return;
+    }
+    // A board smaller than the screen is shown once, not tiled.
+    const std::size_t width = std::min(columns_, board.width());
+    const std::size_t height = std::min(rows_ * cell_height_, board.height());
+    const std::size_t words = board.words_per_row();
+    for (std::size_t y = 0; y < height; ++y) {
+        const std::uint64_t* row = board.row((y0 + y) % board.height());
+        std::uint8_t* codes = &frame_[y / cell_height_ * stride_];
+        // In half-block mode, odd board rows are the lower halves: bit 1.
+        const unsigned shift = static_cast<unsigned>(y % cell_height_);
+        for (std::size_t x = 0; x < width; x += 64) {
+            std::uint64_t bits = gather(row, words, (x0 + x) % board.width());
+            if (width - x < 64)
+                bits &= (std::uint64_t{1} << (width - x)) - 1;
+            for (std::size_t k = 0; k < 8 && x + 8 * k < stride_; ++k)
+                or8(codes + x + 8 * k, kSpread[bits >> (8 * k) & 0xff] << shift);
+        }
+    }
+}
+
+void TerminalRenderer::sample_braille(const Grid& board, std::size_t x0, std::size_t y0)
+{
+    const std::size_t width = std::min(columns_ * 2, board.width());
+    const std::size_t height = std::min(rows_ * 4, board.height());
+    const std::size_t words = board.words_per_row();
+    for (std::size_t y = 0; y < height; ++y) {
+        const std::uint64_t* row = board.row((y0 + y) % board.height());
+        std::uint8_t* codes = &frame_[y / 4 * stride_];
+        const unsigned dy = static_cast<unsigned>(y % 4);
+        for (std::size_t x = 0; x < width; x += 64) {
+            std::uint64_t bits = gather(row, words, (x0 + x) % board.width());
+            if (width - x < 64)
+                bits &= (std::uint64_t{1} << (width - x)) - 1;
+            // 64 cells are 32 characters: the even cells are their left
+            // dots, the odd cells their right dots.
+            const std::uint64_t left = even_bits(bits);
+            const std::uint64_t right = even_bits(bits >> 1);
+            const std::size_t cx = x / 2;
+            for (std::size_t k = 0; k < 4 && cx + 8 * k < stride_; ++k)
+                or8(codes + cx + 8 * k, kSpread[left >> (8 * k) & 0xff] << kBrailleDot[0][dy] |
+                                            kSpread[right >> (8 * k) & 0xff] << kBrailleDot[1][dy]);
+        }
+    }
+}
+
+void TerminalRenderer::move_to(std::size_t x, std::size_t y)
+{
+    // Two 20-digit numbers at most, so the separators always fit.
+    char buf[48] = "\x1b[";
+    char* p = std::to_chars(buf + 2, buf + 22, y + 1).ptr;
+    *p++ = ';';
+    p = std::to_chars(p, buf + 46, x + 1).ptr;
+    *p++ = 'H';
+    out_.append(buf, p);
+}
+
+void TerminalRenderer::emit_row(std::size_t y, bool full)
+{
+    const std::uint8_t* cur = &frame_[y * stride_];
+    const std::uint8_t* prev = &shown_[y * stride_];
+    std::size_t start = 0, end = 0;
+    bool open = false;
+    auto flush = [&] {
+        move_to(start, y);
+        for (std::size_t x = start; x < end; ++x)
+            out_ += glyphs_[cur[x]];
+    };
+    for (std::size_t w = 0; w < stride_; w += 8) {
+        // After a clear the screen is blank, which is what code 0 shows.
+        std::uint64_t diff = load8(cur + w) ^ (full ? 0 : load8(prev + w));
+        while (diff) {
+            const std::size_t i = w + static_cast<std::size_t>(std::countr_zero(diff)) / 8;
+            diff &= ~(std::uint64_t{0xff} << (8 * (i - w)));
+            if (open && i - end <= kMergeGap) {
+                end = i + 1;
+                continue;
+            }
+            if (open)
+                flush();
+            start = i;
+            end = i + 1;
+            open = true;
+        }
+    }
+    if (open)
+        flush();
+}
+
+void TerminalRenderer::send()
+{
+    const char* data = out_.data();
+    std::size_t size = out_.size();
+    while (size > 0) {
+        const ssize_t n = ::write(fd_, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("terminal write failed: ") + std::strerror(errno));
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+std::size_t TerminalRenderer::render(const Grid& board, std::size_t x0, std::size_t y0, std::string_view status)
+{
+    sample(board, x0, y0);
+    const bool full = !drawn_;
+    out_.clear();
+    if (full)
+        out_ += "\x1b[?25l\x1b[2J";
+    for (std::size_t y = 0; y < rows_; ++y)
+        emit_row(y, full);
+    move_to(0, rows_);
+    out_ += status;
+    out_ += "\x1b[K";
+    send();
+
+    // What the same frame costs drawn in full: every row from its start.
+    std::size_t naive = csi_length(0, rows_) + status.size() + 3;
+    for (std::size_t y = 0; y < rows_; ++y) {
+        naive += csi_length(0, y);
+        const std::uint8_t* codes = &frame_[y * stride_];
+        for (std::size_t x = 0; x < columns_; ++x)
+            naive += glyphs_[codes[x]].size();
+    }
+
+    swap(frame_, shown_);
+    drawn_ = true;
+    ++frames_;
+    bytes_ += out_.size();
+    full_bytes_ += naive;
+    return out_.size();
+}
+
+} // namespace conway
@@ -0,0 +1,61 @@
+#include "conway/thread_pool.hpp"
+
+namespace conway {
+
+ThreadPool::ThreadPool(std::size_t threads)
+{
+    for (std::size_t i = 1; i < threads; ++i)
+        workers_.emplace_back([this, i] { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (std::thread& t : workers_)
+        t.join();
+}
+
+void ThreadPool::run(const std::function<void(std::size_t)>& job)
+{
+    if (workers_.empty()) {
+        job(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        pending_ = workers_.size();
+        ++epoch_;
+    }
+    start_.notify_all();
+    job(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    job_ = nullptr;
+}
+
+void ThreadPool::worker_loop(std::size_t index)
+{
+    std::uint64_t seen = 0;
+    for (;;) {
+        const std::function<void(std::size_t)>* job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&] { return stop_ || epoch_ != seen; });
+            if (stop_)
+                return;
+            seen = epoch_;
+            job = job_;
+        }
+        (*job)(index);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0)
+            done_.notify_one();
+    }
+}
+
+} // namespace conway